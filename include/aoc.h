@@ -7,6 +7,9 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 
 /* File utilities */
 char* read_file(const char* filename);
@@ -77,6 +80,28 @@ int max(int a, int b);
 long minl(long a, long b);
 long maxl(long a, long b);
 
+/* Decimal digits: loop-free helpers for digit-length based operations */
+static const uint64_t POW10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* Number of decimal digits in n (1 for 0): estimate from the bit length,
+ * since log10(2) ~= 1233/4096, then correct with one table compare */
+static inline int count_digits(uint64_t n) {
+    int bits = 64 - __builtin_clzll(n | 1);
+    int t = (bits * 1233) >> 12;
+    return t + ((n | 1) >= POW10[t]);
+}
+
+/* Split n into its leading digits and its last low_digits digits */
+static inline void split_digits(uint64_t n, int low_digits, uint64_t* high, uint64_t* low) {
+    *high = n / POW10[low_digits];
+    *low = n % POW10[low_digits];
+}
+
 /* Queue for BFS */
 typedef struct QueueNode {
     void* data;
@@ -95,6 +120,15 @@ void* queue_dequeue(Queue* q);
 bool queue_is_empty(Queue* q);
 void queue_free(Queue* q);
 
+/* 128-bit totals, for sums that overflow 64 bits */
+typedef unsigned __int128 uint128_t;
+void print_uint128(const char* label, uint128_t value);
+
+/* Threading: run worker(&args[i]) on `count` threads and join them.
+ * thread_count(n) is the number of threads worth starting for n tasks. */
+int thread_count(int max_tasks);
+void run_threads(void* (*worker)(void*), void* args, size_t arg_size, int count);
+
 /* Implementation of utility functions */
 #ifdef AOC_IMPLEMENTATION
 
@@ -227,6 +261,46 @@ long lcm(long a, long b) {
     return (a / gcd(a, b)) * b;
 }
 
+void print_uint128(const char* label, uint128_t value) {
+    char buf[40];
+    int i = sizeof(buf) - 1;
+    buf[i] = '\0';
+    do {
+        buf[--i] = '0' + (int)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    printf("%s: %s\n", label, buf + i);
+}
+
+int thread_count(int max_tasks) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (max_tasks < 1) max_tasks = 1;
+    return n < max_tasks ? (int)n : max_tasks;
+}
+
+// A worker whose thread cannot be created (resource limits) runs inline on
+// the calling thread instead, so every worker still runs exactly once
+void run_threads(void* (*worker)(void*), void* args, size_t arg_size, int count) {
+    pthread_t* threads = malloc(count * sizeof(pthread_t));
+    bool* started = calloc(count, sizeof(bool));
+    
+    for (int i = 0; i < count; i++) {
+        void* arg = (char*)args + i * arg_size;
+        if (threads && started && pthread_create(&threads[i], NULL, worker, arg) == 0) {
+            started[i] = true;
+        } else {
+            worker(arg);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (started && started[i]) pthread_join(threads[i], NULL);
+    }
+    
+    free(threads);
+    free(started);
+}
+
 #endif /* AOC_IMPLEMENTATION */
 
 #endif /* AOC_H */
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
@@ -19,43 +20,113 @@ typedef struct {
     int count;
 } Update;
 
+// Rules compiled into a bit matrix over dense page ids: bit (a, b) is set
+// when page a must come before page b
 typedef struct {
-    Rule* rules;
-    int rule_count;
+    int* id;          // page number -> dense id, -1 if the page never appears
+    int max_page;
+    int size;         // number of distinct pages
+    int words;        // 64-bit words per matrix row
+    uint64_t* before; // size rows of `words` words
+} Precedence;
+
+typedef struct {
+    Precedence prec;
     Update* updates;
     int update_count;
 } InputData;
 
+static inline const uint64_t* prec_row(const Precedence* prec, int id) {
+    return prec->before + (size_t)id * prec->words;
+}
+
+static inline bool must_precede(const Precedence* prec, int a, int b) {
+    return (prec_row(prec, a)[b >> 6] >> (b & 63)) & 1;
+}
+
+// Assign dense ids to every page in the rules and updates, then set one bit
+// per rule. The matrix is sized to the pages actually present, so any
+// number of rules costs at most size^2 bits.
+bool compile_rules(Precedence* prec, const Rule* rules, int rule_count,
+                   Update* updates, int update_count) {
+    int max_page = 0;
+    for (int i = 0; i < rule_count; i++) {
+        if (rules[i].before > max_page) max_page = rules[i].before;
+        if (rules[i].after > max_page) max_page = rules[i].after;
+    }
+    for (int i = 0; i < update_count; i++) {
+        for (int j = 0; j < updates[i].count; j++) {
+            if (updates[i].pages[j] > max_page) max_page = updates[i].pages[j];
+        }
+    }
+    
+    prec->max_page = max_page;
+    prec->id = malloc((max_page + 1) * sizeof(int));
+    if (!prec->id) return false;
+    memset(prec->id, -1, (max_page + 1) * sizeof(int));
+    
+    prec->size = 0;
+    for (int i = 0; i < rule_count; i++) {
+        if (prec->id[rules[i].before] < 0) prec->id[rules[i].before] = prec->size++;
+        if (prec->id[rules[i].after] < 0) prec->id[rules[i].after] = prec->size++;
+    }
+    for (int i = 0; i < update_count; i++) {
+        for (int j = 0; j < updates[i].count; j++) {
+            int page = updates[i].pages[j];
+            if (prec->id[page] < 0) prec->id[page] = prec->size++;
+        }
+    }
+    
+    prec->words = (prec->size + 63) / 64;
+    if (prec->words == 0) prec->words = 1;
+    prec->before = calloc((size_t)prec->size * prec->words + 1, sizeof(uint64_t));
+    if (!prec->before) return false;
+    
+    for (int i = 0; i < rule_count; i++) {
+        int a = prec->id[rules[i].before];
+        int b = prec->id[rules[i].after];
+        prec->before[(size_t)a * prec->words + (b >> 6)] |= 1ULL << (b & 63);
+    }
+    
+    return true;
+}
+
 InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* text = read_file(filename);
+    if (!text) {
         perror("Error opening file");
         return NULL;
     }
     
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
+        free(text);
         return NULL;
     }
     
     // Initialize
-    data->rules = NULL;
-    data->rule_count = 0;
     data->updates = NULL;
     data->update_count = 0;
     
-    char line[256];
+    // Rules are only kept until they are compiled into the bit matrix
+    Rule* rules = NULL;
+    int rule_count = 0;
+    
     bool parsing_rules = true;
     int rule_capacity = 100;
     int update_capacity = 100;
     
-    data->rules = malloc(rule_capacity * sizeof(Rule));
+    rules = malloc(rule_capacity * sizeof(Rule));
     data->updates = malloc(update_capacity * sizeof(Update));
     
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
+    // Lines are cut out of the text in place, so updates have no length limit
+    char* next = text;
+    while (*next) {
+        char* line = next;
+        char* end = line + strcspn(line, "\n");
+        next = *end ? end + 1 : end;
+        *end = '\0';
+        line[strcspn(line, "\r")] = '\0';
         
         // Empty line separates rules from updates
         if (strlen(line) == 0) {
@@ -66,14 +137,14 @@ InputData* parse_input(const char* filename) {
         if (parsing_rules) {
             // Parse rule: X|Y
             int before, after;
-            if (sscanf(line, "%d|%d", &before, &after) == 2) {
-                if (data->rule_count >= rule_capacity) {
+            if (sscanf(line, "%d|%d", &before, &after) == 2 && before >= 0 && after >= 0) {
+                if (rule_count >= rule_capacity) {
                     rule_capacity *= 2;
-                    data->rules = realloc(data->rules, rule_capacity * sizeof(Rule));
+                    rules = realloc(rules, rule_capacity * sizeof(Rule));
                 }
-                data->rules[data->rule_count].before = before;
-                data->rules[data->rule_count].after = after;
-                data->rule_count++;
+                rules[rule_count].before = before;
+                rules[rule_count].after = after;
+                rule_count++;
             }
         } else {
             // Parse update: comma-separated numbers
@@ -83,42 +154,70 @@ InputData* parse_input(const char* filename) {
             }
             
             Update* update = &data->updates[data->update_count];
-            update->pages = malloc(100 * sizeof(int));
+            int page_capacity = 32;
+            update->pages = malloc(page_capacity * sizeof(int));
             update->count = 0;
             
             char* token = strtok(line, ",");
             while (token != NULL) {
-                update->pages[update->count++] = atoi(token);
+                if (update->count >= page_capacity) {
+                    page_capacity *= 2;
+                    update->pages = realloc(update->pages, page_capacity * sizeof(int));
+                }
+                int page = atoi(token);
+                if (page >= 0) update->pages[update->count++] = page;
                 token = strtok(NULL, ",");
             }
             
+            if (update->count == 0) {
+                free(update->pages);
+                continue;
+            }
             data->update_count++;
         }
     }
     
-    fclose(file);
+    free(text);
+    
+    bool ok = compile_rules(&data->prec, rules, rule_count, data->updates, data->update_count);
+    free(rules);
+    if (!ok) {
+        fprintf(stderr, "Not enough memory for %d rules\n", rule_count);
+        return NULL;
+    }
+    
     return data;
 }
 
-bool is_valid_order(InputData* data, Update* update) {
-    // For each rule, check if it's violated
-    for (int i = 0; i < data->rule_count; i++) {
-        Rule* rule = &data->rules[i];
+// One pass over the update: a page is out of order exactly when a page
+// seen earlier must come after it, i.e. its row shares a bit with `seen`.
+// `seen` must be all zero on entry and is left all zero.
+bool is_valid_order(const Precedence* prec, const Update* update, uint64_t* seen) {
+    bool valid = true;
+    int i;
+    
+    for (i = 0; i < update->count; i++) {
+        int id = prec->id[update->pages[i]];
+        const uint64_t* row = prec_row(prec, id);
         
-        // Find positions of both pages in the update
-        int before_pos = -1, after_pos = -1;
-        for (int j = 0; j < update->count; j++) {
-            if (update->pages[j] == rule->before) before_pos = j;
-            if (update->pages[j] == rule->after) after_pos = j;
+        for (int w = 0; w < prec->words; w++) {
+            if (row[w] & seen[w]) {
+                valid = false;
+                break;
+            }
         }
+        if (!valid) break;
         
-        // If both pages exist and are in wrong order, it's invalid
-        if (before_pos != -1 && after_pos != -1 && before_pos > after_pos) {
-            return false;
-        }
+        seen[id >> 6] |= 1ULL << (id & 63);
     }
     
-    return true;
+    // Clear only the bits that were set
+    for (int j = 0; j < i; j++) {
+        int id = prec->id[update->pages[j]];
+        seen[id >> 6] &= ~(1ULL << (id & 63));
+    }
+    
+    return valid;
 }
 
 int get_middle_page(Update* update) {
@@ -127,73 +226,132 @@ int get_middle_page(Update* update) {
 
 long part1(InputData* data) {
     long sum = 0;
+    uint64_t* seen = calloc(data->prec.words, sizeof(uint64_t));
     
     for (int i = 0; i < data->update_count; i++) {
-        if (is_valid_order(data, &data->updates[i])) {
+        if (is_valid_order(&data->prec, &data->updates[i], seen)) {
             sum += get_middle_page(&data->updates[i]);
         }
     }
     
+    free(seen);
     return sum;
 }
 
-// Comparison function for sorting based on rules
-int compare_pages(const void* a, const void* b, void* arg) {
-    InputData* data = (InputData*)arg;
-    int page_a = *(int*)a;
-    int page_b = *(int*)b;
-    
-    // Check if there's a rule that determines order
-    for (int i = 0; i < data->rule_count; i++) {
-        Rule* rule = &data->rules[i];
-        if (rule->before == page_a && rule->after == page_b) return -1;
-        if (rule->before == page_b && rule->after == page_a) return 1;
-    }
+// Comparison based on rules: negative if page a must come before page b
+int compare_pages(const Precedence* prec, int page_a, int page_b) {
+    int a = prec->id[page_a];
+    int b = prec->id[page_b];
     
+    if (must_precede(prec, a, b)) return -1;
+    if (must_precede(prec, b, a)) return 1;
     return 0;
 }
 
-void fix_order(InputData* data, Update* update) {
-    // Simple bubble sort based on rules
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (int i = 0; i < update->count - 1; i++) {
-            for (int j = i + 1; j < update->count; j++) {
-                // Check if pages[i] should come after pages[j]
-                for (int k = 0; k < data->rule_count; k++) {
-                    Rule* rule = &data->rules[k];
-                    if (rule->before == update->pages[j] && rule->after == update->pages[i]) {
-                        // Swap
-                        int temp = update->pages[i];
-                        update->pages[i] = update->pages[j];
-                        update->pages[j] = temp;
-                        changed = true;
-                        break;
-                    }
-                }
+// Merge sort on the precedence matrix; `scratch` holds update->count ints
+void fix_order(const Precedence* prec, Update* update, int* scratch) {
+    int n = update->count;
+    int* src = update->pages;
+    int* dst = scratch;
+    
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            
+            while (i < mid && j < hi) {
+                dst[k++] = compare_pages(prec, src[j], src[i]) < 0 ? src[j++] : src[i++];
             }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
         }
+        int* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    
+    if (src != update->pages) {
+        memcpy(update->pages, src, n * sizeof(int));
     }
 }
 
-long part2(InputData* data) {
+// The middle page without sorting: under the total order the rules imply
+// within an update, the page at index count/2 is the one with exactly
+// count - 1 - count/2 successors in the update. Successors are counted with
+// popcounts of the page's row against a mask of the update, so this is
+// O(m×p/64) word operations. `mask` must be all zero on entry and is left
+// all zero. Returns -1 if no page qualifies, which only happens when the
+// rules do not totally order the update.
+int select_middle_page(const Precedence* prec, const Update* update, uint64_t* mask) {
+    int middle = -1;
+    int successors = update->count - 1 - update->count / 2;
+    
+    for (int i = 0; i < update->count; i++) {
+        int id = prec->id[update->pages[i]];
+        mask[id >> 6] |= 1ULL << (id & 63);
+    }
+    
+    for (int i = 0; i < update->count && middle < 0; i++) {
+        const uint64_t* row = prec_row(prec, prec->id[update->pages[i]]);
+        int n = 0;
+        for (int w = 0; w < prec->words; w++) {
+            n += __builtin_popcountll(row[w] & mask[w]);
+        }
+        if (n == successors) middle = update->pages[i];
+    }
+    
+    for (int i = 0; i < update->count; i++) {
+        int id = prec->id[update->pages[i]];
+        mask[id >> 6] &= ~(1ULL << (id & 63));
+    }
+    
+    return middle;
+}
+
+typedef enum {
+    MIDDLE_SELECT, // count successors of each page with popcounts
+    MIDDLE_SORT    // fix the order with a full sort, then read the middle
+} MiddleMode;
+
+long part2(InputData* data, MiddleMode mode) {
     long sum = 0;
+    uint64_t* seen = calloc(data->prec.words, sizeof(uint64_t));
     
+    int max_count = 0;
     for (int i = 0; i < data->update_count; i++) {
-        if (!is_valid_order(data, &data->updates[i])) {
-            fix_order(data, &data->updates[i]);
-            sum += get_middle_page(&data->updates[i]);
+        if (data->updates[i].count > max_count) max_count = data->updates[i].count;
+    }
+    int* scratch = malloc((max_count + 1) * sizeof(int));
+    
+    for (int i = 0; i < data->update_count; i++) {
+        if (!is_valid_order(&data->prec, &data->updates[i], seen)) {
+            int middle = mode == MIDDLE_SELECT
+                ? select_middle_page(&data->prec, &data->updates[i], seen)
+                : -1;
+            if (middle < 0) {
+                fix_order(&data->prec, &data->updates[i], scratch);
+                middle = get_middle_page(&data->updates[i]);
+            }
+            sum += middle;
         }
     }
     
+    free(scratch);
+    free(seen);
     return sum;
 }
 
 int main(int argc, char* argv[]) {
-    const char* input_file = (argc > 1 && strcmp(argv[1], "test") == 0) 
-        ? "inputs/day05_test.txt" 
-        : "inputs/day05.txt";
+    const char* input_file = "inputs/day05.txt";
+    MiddleMode mode = MIDDLE_SELECT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "test") == 0) {
+            input_file = "inputs/day05_test.txt";
+        } else if (strcmp(argv[i], "sort") == 0) {
+            mode = MIDDLE_SORT;
+        }
+    }
     
     InputData* data = parse_input(input_file);
     if (!data) {
@@ -202,13 +360,14 @@ int main(int argc, char* argv[]) {
     }
     
     printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    printf("Part 2: %ld\n", part2(data, mode));
     
     // Free allocated memory
     for (int i = 0; i < data->update_count; i++) {
         free(data->updates[i].pages);
     }
-    free(data->rules);
+    free(data->prec.id);
+    free(data->prec.before);
     free(data->updates);
     free(data);
     
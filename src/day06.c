@@ -16,31 +16,59 @@ typedef struct {
     int guard_row;
     int guard_col;
     int guard_dir; // 0=North, 1=East, 2=South, 3=West
+    int* jump[4];  // jump[dir][cell]: cell where the guard stops before the next obstacle, -1 if it leaves
 } InputData;
 
+// A cell on the guard's original route, with the state just before first entering it
+typedef struct {
+    int cell;
+    int from_cell;
+    int dir;
+} RouteStep;
+
+// Per-thread scratch for loop checks
+typedef struct {
+    unsigned int* seen; // (cell, dir) turn states, stamped per loop check
+    unsigned int stamp;
+} LoopScratch;
+
+// Work assignment for one part 2 thread
+typedef struct {
+    const InputData* data;
+    const RouteStep* route;
+    int route_len;
+    int thread;
+    int num_threads;
+    LoopScratch scratch;
+    long count;
+} LoopWorker;
+
+void build_jump_table(InputData* data);
+
 InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* content = read_file(filename);
+    if (!content) {
         perror("Error opening file");
         return NULL;
     }
     
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
+        free(content);
         return NULL;
     }
     
-    // First pass: count rows and cols
+    // First pass: count rows and cols, with no limit on the line length
     data->rows = 0;
     data->cols = 0;
-    char line[256];
-    
-    while (fgets(line, sizeof(line), file)) {
-        int len = strlen(line);
-        if (line[len-1] == '\n') len--;
-        if (len > data->cols) data->cols = len;
-        data->rows++;
+    for (char* p = content; *p; ) {
+        int len = strcspn(p, "\r\n");
+        if (len > 0) {
+            if (len > data->cols) data->cols = len;
+            data->rows++;
+        }
+        p += len;
+        p += strspn(p, "\r\n");
     }
     
     // Allocate grid
@@ -52,27 +80,30 @@ InputData* parse_input(const char* filename) {
     }
     
     // Second pass: read the grid
-    rewind(file);
     int row = 0;
-    while (fgets(line, sizeof(line), file)) {
-        int len = strlen(line);
-        if (line[len-1] == '\n') line[len-1] = '\0';
-        
-        for (int col = 0; col < strlen(line); col++) {
-            data->grid[row][col] = line[col];
-            
-            // Find guard position and direction
-            if (line[col] == '^') {
-                data->guard_row = row;
-                data->guard_col = col;
-                data->guard_dir = 0; // North
-                data->grid[row][col] = '.'; // Clear guard marker
+    for (char* p = content; *p; ) {
+        int len = strcspn(p, "\r\n");
+        if (len > 0) {
+            for (int col = 0; col < len; col++) {
+                data->grid[row][col] = p[col];
+                
+                // Find guard position and direction
+                if (p[col] == '^') {
+                    data->guard_row = row;
+                    data->guard_col = col;
+                    data->guard_dir = 0; // North
+                    data->grid[row][col] = '.'; // Clear guard marker
+                }
             }
+            row++;
         }
-        row++;
+        p += len;
+        p += strspn(p, "\r\n");
     }
     
-    fclose(file);
+    free(content);
+    
+    build_jump_table(data);
     return data;
 }
 
@@ -80,8 +111,57 @@ InputData* parse_input(const char* filename) {
 int dr[] = {-1, 0, 1, 0};
 int dc[] = {0, 1, 0, -1};
 
-bool is_in_bounds(InputData* data, int row, int col) {
-    return row >= 0 && row < data->rows && col >= 0 && col < data->cols;
+void build_jump_table(InputData* data) {
+    int rows = data->rows;
+    int cols = data->cols;
+    
+    for (int dir = 0; dir < 4; dir++) {
+        data->jump[dir] = malloc((size_t)rows * cols * sizeof(int));
+    }
+    
+    // North and South: sweep each column towards the obstacle side
+    for (int col = 0; col < cols; col++) {
+        int stop = -1;
+        for (int row = 0; row < rows; row++) {
+            if (data->grid[row][col] == '#') {
+                data->jump[0][row * cols + col] = -1;
+                stop = (row + 1) * cols + col;
+            } else {
+                data->jump[0][row * cols + col] = stop;
+            }
+        }
+        stop = -1;
+        for (int row = rows - 1; row >= 0; row--) {
+            if (data->grid[row][col] == '#') {
+                data->jump[2][row * cols + col] = -1;
+                stop = (row - 1) * cols + col;
+            } else {
+                data->jump[2][row * cols + col] = stop;
+            }
+        }
+    }
+    
+    // East and West: sweep each row towards the obstacle side
+    for (int row = 0; row < rows; row++) {
+        int stop = -1;
+        for (int col = cols - 1; col >= 0; col--) {
+            if (data->grid[row][col] == '#') {
+                data->jump[1][row * cols + col] = -1;
+                stop = row * cols + col - 1;
+            } else {
+                data->jump[1][row * cols + col] = stop;
+            }
+        }
+        stop = -1;
+        for (int col = 0; col < cols; col++) {
+            if (data->grid[row][col] == '#') {
+                data->jump[3][row * cols + col] = -1;
+                stop = row * cols + col + 1;
+            } else {
+                data->jump[3][row * cols + col] = stop;
+            }
+        }
+    }
 }
 
 long part1(InputData* data) {
@@ -100,30 +180,25 @@ long part1(InputData* data) {
     int count = 1;
     
     while (true) {
-        // Calculate next position
-        int next_row = row + dr[dir];
-        int next_col = col + dc[dir];
+        // Jump to the next turn, or to the edge of the map if the guard leaves
+        int stop = data->jump[dir][row * data->cols + col];
+        int end_row = stop < 0 ? (dr[dir] < 0 ? 0 : dr[dir] > 0 ? data->rows - 1 : row) : stop / data->cols;
+        int end_col = stop < 0 ? (dc[dir] < 0 ? 0 : dc[dir] > 0 ? data->cols - 1 : col) : stop % data->cols;
         
-        // Check if guard leaves the map
-        if (!is_in_bounds(data, next_row, next_col)) {
-            break;
-        }
-        
-        // Check for obstacle
-        if (data->grid[next_row][next_col] == '#') {
-            // Turn right
-            dir = (dir + 1) % 4;
-        } else {
-            // Move forward
-            row = next_row;
-            col = next_col;
-            
-            // Mark as visited
+        // Mark every cell along the segment
+        while (row != end_row || col != end_col) {
+            row += dr[dir];
+            col += dc[dir];
             if (!visited[row][col]) {
                 visited[row][col] = true;
                 count++;
             }
         }
+        
+        if (stop < 0) break;
+        
+        // Turn right
+        dir = (dir + 1) % 4;
     }
     
     // Free visited grid
@@ -135,84 +210,153 @@ long part1(InputData* data) {
     return count;
 }
 
-bool creates_loop(InputData* data, int obstacle_row, int obstacle_col) {
-    // Temporarily place obstacle
-    char original = data->grid[obstacle_row][obstacle_col];
-    if (original == '#') return false; // Already an obstacle
-    if (obstacle_row == data->guard_row && obstacle_col == data->guard_col) return false; // Can't place at start
+// Find the cell where the guard stops when walking from `cell` in `dir`,
+// taking the temporary obstacle into account. Returns -1 if the guard leaves.
+int next_stop(const InputData* data, int cell, int dir, int obstacle_row, int obstacle_col) {
+    int stop = data->jump[dir][cell];
+    int row = cell / data->cols;
+    int col = cell % data->cols;
+    int stop_row = stop / data->cols;
+    int stop_col = stop % data->cols;
+    
+    switch (dir) {
+        case 0: // North
+            if (obstacle_col == col && obstacle_row < row && (stop < 0 || obstacle_row >= stop_row))
+                return (obstacle_row + 1) * data->cols + col;
+            break;
+        case 1: // East
+            if (obstacle_row == row && obstacle_col > col && (stop < 0 || obstacle_col <= stop_col))
+                return row * data->cols + obstacle_col - 1;
+            break;
+        case 2: // South
+            if (obstacle_col == col && obstacle_row > row && (stop < 0 || obstacle_row <= stop_row))
+                return (obstacle_row - 1) * data->cols + col;
+            break;
+        case 3: // West
+            if (obstacle_row == row && obstacle_col < col && (stop < 0 || obstacle_col >= stop_col))
+                return row * data->cols + obstacle_col + 1;
+            break;
+    }
+    
+    return stop;
+}
+
+// Simulate from (start_cell, start_dir) with a temporary obstacle overlaid on
+// the shared grid; the grid itself is never modified
+bool creates_loop(const InputData* data, LoopScratch* scratch, int start_cell, int start_dir,
+                  int obstacle_row, int obstacle_col) {
+    // New stamp invalidates all previously seen states
+    if (++scratch->stamp == 0) {
+        memset(scratch->seen, 0, (size_t)data->rows * data->cols * 4 * sizeof(unsigned int));
+        scratch->stamp = 1;
+    }
     
-    data->grid[obstacle_row][obstacle_col] = '#';
+    int cell = start_cell;
+    int dir = start_dir;
     
-    // Track visited states (position + direction)
-    int state_capacity = 10000;
-    int* visited_states = malloc(state_capacity * sizeof(int));
-    int state_count = 0;
+    // Jump from turn to turn; revisiting a turn state means a loop
+    while (true) {
+        cell = next_stop(data, cell, dir, obstacle_row, obstacle_col);
+        if (cell < 0) return false;
+        
+        dir = (dir + 1) % 4;
+        
+        int state = cell * 4 + dir;
+        if (scratch->seen[state] == scratch->stamp) return true;
+        scratch->seen[state] = scratch->stamp;
+    }
+}
+
+// Walk the original route and record every cell (except the start) the first
+// time it is entered, together with the cell and direction it was entered from
+RouteStep* record_route(InputData* data, int* count) {
+    bool* visited = calloc((size_t)data->rows * data->cols, sizeof(bool));
+    int capacity = 1024;
+    RouteStep* route = malloc(capacity * sizeof(RouteStep));
+    *count = 0;
     
     int row = data->guard_row;
     int col = data->guard_col;
     int dir = data->guard_dir;
-    
-    bool is_loop = false;
+    visited[row * data->cols + col] = true;
     
     while (true) {
-        // Check if we've been in this state before
-        int state = (row * data->cols + col) * 4 + dir;
+        int stop = data->jump[dir][row * data->cols + col];
+        int end_row = stop < 0 ? (dr[dir] < 0 ? 0 : dr[dir] > 0 ? data->rows - 1 : row) : stop / data->cols;
+        int end_col = stop < 0 ? (dc[dir] < 0 ? 0 : dc[dir] > 0 ? data->cols - 1 : col) : stop % data->cols;
         
-        for (int i = 0; i < state_count; i++) {
-            if (visited_states[i] == state) {
-                is_loop = true;
-                break;
+        while (row != end_row || col != end_col) {
+            int from_cell = row * data->cols + col;
+            row += dr[dir];
+            col += dc[dir];
+            int cell = row * data->cols + col;
+            if (!visited[cell]) {
+                visited[cell] = true;
+                if (*count >= capacity) {
+                    capacity *= 2;
+                    route = realloc(route, capacity * sizeof(RouteStep));
+                }
+                route[(*count)++] = (RouteStep){cell, from_cell, dir};
             }
         }
         
-        if (is_loop) break;
-        
-        // Add current state
-        if (state_count >= state_capacity) {
-            state_capacity *= 2;
-            visited_states = realloc(visited_states, state_capacity * sizeof(int));
-        }
-        visited_states[state_count++] = state;
-        
-        // Calculate next position
-        int next_row = row + dr[dir];
-        int next_col = col + dc[dir];
-        
-        // Check if guard leaves the map
-        if (!is_in_bounds(data, next_row, next_col)) {
-            break;
-        }
+        if (stop < 0) break;
         
-        // Check for obstacle
-        if (data->grid[next_row][next_col] == '#') {
-            // Turn right
-            dir = (dir + 1) % 4;
-        } else {
-            // Move forward
-            row = next_row;
-            col = next_col;
-        }
+        dir = (dir + 1) % 4;
     }
     
-    // Restore original
-    data->grid[obstacle_row][obstacle_col] = original;
-    free(visited_states);
+    free(visited);
+    return route;
+}
+
+void* part2_worker(void* arg) {
+    LoopWorker* w = arg;
+    const InputData* data = w->data;
+    
+    // Interleave candidates so threads get a similar mix of short and long walks
+    for (int i = w->thread; i < w->route_len; i += w->num_threads) {
+        int row = w->route[i].cell / data->cols;
+        int col = w->route[i].cell % data->cols;
+        if (creates_loop(data, &w->scratch, w->route[i].from_cell, w->route[i].dir, row, col)) {
+            w->count++;
+        }
+    }
     
-    return is_loop;
+    return NULL;
 }
 
 long part2(InputData* data) {
-    int count = 0;
+    int route_len;
+    RouteStep* route = record_route(data, &route_len);
     
-    // Try placing an obstacle at each position
-    for (int row = 0; row < data->rows; row++) {
-        for (int col = 0; col < data->cols; col++) {
-            if (creates_loop(data, row, col)) {
-                count++;
-            }
-        }
+    int num_threads = thread_count(route_len);
+    
+    // Only cells on the original route can change the guard's path. Before
+    // first reaching a cell the route is unaffected by an obstacle there, so
+    // each check resumes from the state just before that cell.
+    LoopWorker* workers = malloc(num_threads * sizeof(LoopWorker));
+    for (int t = 0; t < num_threads; t++) {
+        workers[t] = (LoopWorker){
+            .data = data,
+            .route = route,
+            .route_len = route_len,
+            .thread = t,
+            .num_threads = num_threads,
+            .scratch = {calloc((size_t)data->rows * data->cols * 4, sizeof(unsigned int)), 0},
+            .count = 0,
+        };
     }
     
+    run_threads(part2_worker, workers, sizeof(LoopWorker), num_threads);
+    
+    long count = 0;
+    for (int t = 0; t < num_threads; t++) {
+        count += workers[t].count;
+        free(workers[t].scratch.seen);
+    }
+    
+    free(workers);
+    free(route);
     return count;
 }
 
@@ -235,6 +379,9 @@ int main(int argc, char* argv[]) {
         free(data->grid[i]);
     }
     free(data->grid);
+    for (int dir = 0; dir < 4; dir++) {
+        free(data->jump[dir]);
+    }
     free(data);
     
     return 0;
@@ -5,13 +5,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
 typedef struct {
-    long target;
-    int* numbers;
+    uint64_t target;
+    uint64_t* numbers;
     int count;
 } Equation;
 
@@ -38,7 +39,7 @@ InputData* parse_input(const char* filename) {
     int capacity = 100;
     data->equations = malloc(capacity * sizeof(Equation));
     
-    char line[256];
+    char line[4096];
     while (fgets(line, sizeof(line), file)) {
         if (data->count >= capacity) {
             capacity *= 2;
@@ -52,18 +53,28 @@ InputData* parse_input(const char* filename) {
         if (!colon) continue;
         
         *colon = '\0';
-        eq->target = atol(line);
+        eq->target = strtoull(line, NULL, 10);
         
         // Parse numbers
-        eq->numbers = malloc(50 * sizeof(int));
+        int num_capacity = 16;
+        eq->numbers = malloc(num_capacity * sizeof(uint64_t));
         eq->count = 0;
         
         char* token = strtok(colon + 1, " \n");
         while (token != NULL) {
-            eq->numbers[eq->count++] = atoi(token);
+            if (eq->count >= num_capacity) {
+                num_capacity *= 2;
+                eq->numbers = realloc(eq->numbers, num_capacity * sizeof(uint64_t));
+            }
+            eq->numbers[eq->count++] = strtoull(token, NULL, 10);
             token = strtok(NULL, " \n");
         }
         
+        if (eq->count == 0) {
+            free(eq->numbers);
+            continue;
+        }
+        
         data->count++;
     }
     
@@ -71,79 +82,167 @@ InputData* parse_input(const char* filename) {
     return data;
 }
 
-bool can_reach_target(long current, int* numbers, int index, int count, long target, bool part2) {
-    if (index == count) {
-        return current == target;
+// How cheaply an equation can be made true; ordered so that smaller is better
+typedef enum {
+    SOLVABLE_PLAIN,   // with + and * alone: counts for both parts
+    SOLVABLE_CONCAT,  // only once || is allowed: counts for part 2
+    UNSOLVABLE
+} Solvability;
+
+// Undo a concatenation: if target ends in the digits of value, store the
+// remaining leading digits in prefix. A 20-digit value has no power of 10
+// above it in 64 bits; it can only be a suffix of a target equal to it.
+bool strip_suffix(uint64_t target, uint64_t value, uint64_t* prefix) {
+    int digits = count_digits(value);
+    if (digits == 20) {
+        *prefix = 0;
+        return target == value;
+    }
+    *prefix = target / POW10[digits];
+    return target % POW10[digits] == value;
+}
+
+// Work backwards from the target, undoing the last operand each step.
+// A branch is only taken where its inverse is valid, which prunes almost
+// every branch at once: subtraction needs target >= value, division needs
+// value to divide target, and un-concatenation needs target to end in the
+// digits of value. Every inverse shrinks the target, so the search can never
+// overflow no matter how large the operands are. All three operators are
+// allowed: this answers whether a solution with || exists at all.
+bool can_reach_target(uint64_t target, const uint64_t* numbers, int count) {
+    uint64_t value = numbers[count - 1];
+    
+    if (count == 1) {
+        return target == value;
     }
     
-    // Try addition
-    if (can_reach_target(current + numbers[index], numbers, index + 1, count, target, part2)) {
+    // Try stripping the concatenated suffix
+    uint64_t prefix;
+    if (strip_suffix(target, value, &prefix) &&
+        can_reach_target(prefix, numbers, count - 1)) {
         return true;
     }
     
-    // Try multiplication
-    if (can_reach_target(current * numbers[index], numbers, index + 1, count, target, part2)) {
+    // Try undoing multiplication
+    if (value == 0) {
+        if (target == 0) return true;
+    } else if (target % value == 0 &&
+               can_reach_target(target / value, numbers, count - 1)) {
         return true;
     }
     
-    // Part 2: Try concatenation
-    if (part2) {
-        // Calculate concatenated value
-        long concat = current;
-        int temp = numbers[index];
-        int digits = 0;
-        
-        // Count digits in the number to concatenate
-        if (temp == 0) {
-            digits = 1;
-        } else {
-            int t = temp;
-            while (t > 0) {
-                digits++;
-                t /= 10;
-            }
-        }
-        
-        // Shift current value and add the new number
-        for (int i = 0; i < digits; i++) {
-            concat *= 10;
-        }
-        concat += numbers[index];
-        
-        if (can_reach_target(concat, numbers, index + 1, count, target, part2)) {
-            return true;
-        }
+    // Try undoing addition
+    if (target >= value &&
+        can_reach_target(target - value, numbers, count - 1)) {
+        return true;
     }
     
     return false;
 }
 
-long part1(InputData* data) {
-    long sum = 0;
+// The same backward search, classifying the equation for both parts at
+// once. Only results better than `bound` are of interest: once one branch
+// proves SOLVABLE_CONCAT, the remaining branches are searched with bound
+// SOLVABLE_CONCAT, which drops every || below them and leaves the plain
+// + and * search. No part of the operator tree is searched twice.
+Solvability classify(uint64_t target, const uint64_t* numbers, int count, Solvability bound) {
+    uint64_t value = numbers[count - 1];
     
-    for (int i = 0; i < data->count; i++) {
-        Equation* eq = &data->equations[i];
-        
-        if (can_reach_target(eq->numbers[0], eq->numbers, 1, eq->count, eq->target, false)) {
-            sum += eq->target;
-        }
+    if (count == 1) {
+        return target == value ? SOLVABLE_PLAIN : UNSOLVABLE;
+    }
+    
+    Solvability best = UNSOLVABLE;
+    Solvability sub;
+    
+    // Try undoing multiplication
+    if (value == 0) {
+        if (target == 0) return SOLVABLE_PLAIN;
+    } else if (target % value == 0) {
+        sub = classify(target / value, numbers, count - 1, bound);
+        if (sub == SOLVABLE_PLAIN) return SOLVABLE_PLAIN;
+        if (sub < bound) best = bound = sub;
+    }
+    
+    // Try undoing addition
+    if (target >= value) {
+        sub = classify(target - value, numbers, count - 1, bound);
+        if (sub == SOLVABLE_PLAIN) return SOLVABLE_PLAIN;
+        if (sub < bound) best = bound = sub;
+    }
+    
+    if (bound <= SOLVABLE_CONCAT) return best;
+    
+    // Try stripping the concatenated suffix; any solution below it will do
+    uint64_t prefix;
+    if (strip_suffix(target, value, &prefix) &&
+        can_reach_target(prefix, numbers, count - 1)) {
+        return SOLVABLE_CONCAT;
     }
     
-    return sum;
+    return UNSOLVABLE;
 }
 
-long part2(InputData* data) {
-    long sum = 0;
+// Targets run up to 19 digits, so a few of them already overflow a 64-bit sum
+typedef struct {
+    uint128_t part1;
+    uint128_t part2;
+} CalibrationSums;
+
+// Work assignment for one equation solving thread
+typedef struct {
+    const InputData* data;
+    int first;  // thread index: equations first, first + stride, ...
+    int stride;
+    CalibrationSums sums;
+} SolveWorker;
+
+void* solve_worker(void* arg) {
+    SolveWorker* w = arg;
     
-    for (int i = 0; i < data->count; i++) {
-        Equation* eq = &data->equations[i];
-        
-        if (can_reach_target(eq->numbers[0], eq->numbers, 1, eq->count, eq->target, true)) {
-            sum += eq->target;
+    // Equations differ wildly in cost, so threads take them interleaved
+    // rather than in contiguous blocks
+    for (int i = w->first; i < w->data->count; i += w->stride) {
+        const Equation* eq = &w->data->equations[i];
+        switch (classify(eq->target, eq->numbers, eq->count, UNSOLVABLE)) {
+            case SOLVABLE_PLAIN:
+                w->sums.part1 += eq->target;
+                w->sums.part2 += eq->target;
+                break;
+            case SOLVABLE_CONCAT:
+                w->sums.part2 += eq->target;
+                break;
+            case UNSOLVABLE:
+                break;
         }
     }
+    return NULL;
+}
+
+// Classify every equation once and return the sums for both parts
+CalibrationSums solve(InputData* data) {
+    int num_threads = thread_count(data->count);
+    
+    SolveWorker* workers = malloc(num_threads * sizeof(SolveWorker));
+    for (int t = 0; t < num_threads; t++) {
+        workers[t] = (SolveWorker){
+            .data = data,
+            .first = t,
+            .stride = num_threads,
+            .sums = {0, 0},
+        };
+    }
+    
+    run_threads(solve_worker, workers, sizeof(SolveWorker), num_threads);
+    
+    CalibrationSums sums = {0, 0};
+    for (int t = 0; t < num_threads; t++) {
+        sums.part1 += workers[t].sums.part1;
+        sums.part2 += workers[t].sums.part2;
+    }
+    free(workers);
     
-    return sum;
+    return sums;
 }
 
 int main(int argc, char* argv[]) {
@@ -157,8 +256,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    CalibrationSums sums = solve(data);
+    print_uint128("Part 1", sums.part1);
+    print_uint128("Part 2", sums.part2);
     
     // Free allocated memory
     for (int i = 0; i < data->count; i++) {
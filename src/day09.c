@@ -5,206 +5,287 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
+// The disk map digits, mapped read-only from the input file
 typedef struct {
-    int* disk;
-    int size;
-    char* input;
-    int input_len;
-} InputData;
+    const char* digits;
+    size_t length;     // number of digits, trailing newline excluded
+    size_t map_size;
+} DiskMap;
 
-InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        return NULL;
+bool disk_map_open(const char* filename, DiskMap* map) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
     }
     
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+    
+    map->digits = addr;
+    map->map_size = st.st_size;
+    map->length = st.st_size;
+    while (map->length > 0 && !isdigit((unsigned char)map->digits[map->length - 1])) {
+        map->length--;
+    }
+    return true;
+}
+
+void disk_map_close(DiskMap* map) {
+    munmap((void*)map->digits, map->map_size);
+}
+
+// A contiguous run of blocks on the disk. Positions are 64-bit: a map of
+// n digits spans up to 9n blocks, past INT_MAX once n passes ~2.4e8.
+// Lengths are too, since free spans joined across empty files can be long.
+typedef struct {
+    int64_t start;
+    int64_t length;
+} Segment;
+
+typedef struct {
+    DiskMap map;
+    Segment* files; // files[id]
+    Segment* spans; // maximal runs of free blocks, left to right
+    size_t file_count;
+    size_t span_count;
+} InputData;
+
+InputData* parse_input(const char* filename) {
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
         return NULL;
     }
     
-    // Read the input string
-    data->input = malloc(20000);
-    if (fgets(data->input, 20000, file) == NULL) {
-        free(data->input);
+    if (!disk_map_open(filename, &data->map)) {
+        perror("Error opening file");
         free(data);
-        fclose(file);
         return NULL;
     }
+    const char* input = data->map.digits;
+    size_t input_len = data->map.length;
     
-    // Remove newline
-    data->input_len = strlen(data->input);
-    if (data->input[data->input_len - 1] == '\n') {
-        data->input[data->input_len - 1] = '\0';
-        data->input_len--;
-    }
-    
-    // Calculate disk size
-    data->size = 0;
-    for (int i = 0; i < data->input_len; i++) {
-        data->size += data->input[i] - '0';
+    // Split the disk map into file segments and free spans
+    data->file_count = (input_len + 1) / 2;
+    data->files = malloc(data->file_count * sizeof(Segment));
+    data->spans = malloc((input_len / 2 + 1) * sizeof(Segment));
+    if (!data->files || !data->spans) {
+        fprintf(stderr, "Not enough memory to index %zu digits; try the stream mode\n", input_len);
+        free(data->files);
+        free(data->spans);
+        disk_map_close(&data->map);
+        free(data);
+        return NULL;
     }
     
-    // Allocate disk (-1 for empty space)
-    data->disk = malloc(data->size * sizeof(int));
-    
-    // Fill disk
-    int pos = 0;
-    int file_id = 0;
-    for (int i = 0; i < data->input_len; i++) {
-        int len = data->input[i] - '0';
-        
+    // A 0-length file takes no blocks, so the free digits around it are one
+    // run on the disk; spans that touch are joined into a single span
+    int64_t pos = 0;
+    data->span_count = 0;
+    for (size_t i = 0; i < input_len; i++) {
+        Segment seg = {pos, input[i] - '0'};
         if (i % 2 == 0) {
-            // File
-            for (int j = 0; j < len; j++) {
-                data->disk[pos++] = file_id;
-            }
-            file_id++;
-        } else {
-            // Free space
-            for (int j = 0; j < len; j++) {
-                data->disk[pos++] = -1;
+            data->files[i / 2] = seg;
+        } else if (seg.length > 0) {
+            Segment* last = data->span_count > 0 ? &data->spans[data->span_count - 1] : NULL;
+            if (last && last->start + last->length == seg.start) {
+                last->length += seg.length;
+            } else {
+                data->spans[data->span_count++] = seg;
             }
         }
+        pos += seg.length;
     }
     
-    fclose(file);
     return data;
 }
 
-void compact_disk_part1(int* disk, int size) {
-    // Move file blocks from right to leftmost free space
-    int left = 0;
-    int right = size - 1;
+// Checksum of `length` blocks of file `id` starting at `start`, in 128 bits
+// since checksums of multi-gigabyte disk maps overflow 64 bits:
+// id * (start + (start + 1) + ... + (start + length - 1))
+uint128_t run_checksum(uint128_t id, uint128_t start, uint128_t length) {
+    return id * (length * start + length * (length - 1) / 2);
+}
+
+// Part 1 straight off the digit string: walk files from the left, filling
+// each free span with blocks from the rightmost file that still has blocks
+// left. Both ends are read in place, so memory use is O(1) beyond the map.
+uint128_t stream_part1(const DiskMap* map) {
+    if (map->length == 0) return 0;
+    
+    const char* d = map->digits;
+    size_t left = 0;
+    size_t right = (map->length - 1) / 2;
+    int right_remaining = d[2 * right] - '0';
+    uint128_t pos = 0;
+    uint128_t checksum = 0;
     
     while (left < right) {
-        // Find next free space from left
-        while (left < size && disk[left] != -1) {
-            left++;
-        }
+        int file_len = d[2 * left] - '0';
+        checksum += run_checksum(left, pos, file_len);
+        pos += file_len;
         
-        // Find next file block from right
-        while (right >= 0 && disk[right] == -1) {
-            right--;
+        int gap = d[2 * left + 1] - '0';
+        while (gap > 0 && left < right) {
+            int take = gap < right_remaining ? gap : right_remaining;
+            checksum += run_checksum(right, pos, take);
+            pos += take;
+            gap -= take;
+            right_remaining -= take;
+            if (right_remaining == 0) {
+                right--;
+                right_remaining = d[2 * right] - '0';
+            }
         }
         
-        if (left < right) {
-            // Move block
-            disk[left] = disk[right];
-            disk[right] = -1;
-            left++;
-            right--;
-        }
+        left++;
     }
-}
-
-long calculate_checksum(int* disk, int size) {
-    long checksum = 0;
-    for (int i = 0; i < size; i++) {
-        if (disk[i] != -1) {
-            checksum += (long)i * disk[i];
-        }
+    
+    // Whatever is left of the file both ends met at stays where it lands
+    if (left == right) {
+        checksum += run_checksum(right, pos, right_remaining);
     }
+    
     return checksum;
 }
 
-long part1(InputData* data) {
-    // Create a copy of the disk
-    int* disk = malloc(data->size * sizeof(int));
-    memcpy(disk, data->disk, data->size * sizeof(int));
-    
-    // Compact the disk
-    compact_disk_part1(disk, data->size);
-    
-    // Calculate checksum
-    long checksum = calculate_checksum(disk, data->size);
+uint128_t part1(InputData* data) {
+    return stream_part1(&data->map);
+}
+
+// Min-heap of free spans ordered by start position
+typedef struct {
+    Segment* items;
+    size_t size;
+    size_t capacity;
+} SpanHeap;
+
+void span_heap_push(SpanHeap* heap, Segment span) {
+    if (heap->size >= heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 64;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(Segment));
+    }
     
-    free(disk);
-    return checksum;
+    size_t i = heap->size++;
+    while (i > 0 && heap->items[(i - 1) / 2].start > span.start) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = span;
+}
+
+void span_heap_pop(SpanHeap* heap) {
+    Segment last = heap->items[--heap->size];
+    size_t i = 0;
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && heap->items[child + 1].start < heap->items[child].start) child++;
+        if (heap->items[child].start >= last.start) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->size > 0) heap->items[i] = last;
+}
+
+// Files are at most 9 blocks, so every span of 10 or more shares one heap
+#define LONG_SPAN 10
+
+static inline int span_bucket(int64_t length) {
+    return length < LONG_SPAN ? (int)length : LONG_SPAN;
 }
 
-void compact_disk_part2(int* disk, int size, char* input, int input_len) {
-    // Get file count
-    int file_count = (input_len + 1) / 2;
+// Move whole files, highest id first, into the leftmost free span that fits.
+// Free spans sit in one heap per length (1-9, then 10+) ordered by position,
+// so the leftmost fitting span is the smallest top among heaps[size..10].
+// A file only ever moves left, and every later file starts left of it, so
+// the space it vacates can never be used again and is not tracked.
+void compact_disk_part2(Segment* files, size_t file_count, const Segment* spans, size_t span_count) {
+    SpanHeap heaps[LONG_SPAN + 1] = {{0}};
+    for (size_t i = 0; i < span_count; i++) {
+        span_heap_push(&heaps[span_bucket(spans[i].length)], spans[i]);
+    }
     
-    // Process files in decreasing order of file ID
-    for (int file_id = file_count - 1; file_id >= 0; file_id--) {
-        // Find the file's current position and size
-        int file_start = -1;
-        int file_size = 0;
-        
-        // Calculate expected file size from input
-        int input_index = file_id * 2;
-        if (input_index < input_len) {
-            file_size = input[input_index] - '0';
-        }
+    for (size_t file_id = file_count; file_id-- > 0; ) {
+        Segment* f = &files[file_id];
+        if (f->length == 0) continue;
         
-        // Find where the file currently is
-        for (int i = 0; i < size; i++) {
-            if (disk[i] == file_id) {
-                if (file_start == -1) file_start = i;
+        int best = -1;
+        int64_t best_pos = f->start;
+        for (int len = f->length; len <= LONG_SPAN; len++) {
+            if (heaps[len].size > 0 && heaps[len].items[0].start < best_pos) {
+                best_pos = heaps[len].items[0].start;
+                best = len;
             }
         }
         
-        if (file_start == -1 || file_size == 0) continue;
+        if (best == -1) continue;
         
-        // Find leftmost span of free space that can fit the file
-        int best_pos = -1;
-        for (int i = 0; i < file_start; i++) {
-            if (disk[i] == -1) {
-                // Check if we have enough contiguous free space
-                int free_count = 0;
-                for (int j = i; j < size && disk[j] == -1; j++) {
-                    free_count++;
-                    if (free_count >= file_size) {
-                        best_pos = i;
-                        break;
-                    }
-                }
-                if (best_pos != -1) break;
-            }
-        }
-        
-        // If found a suitable position, move the file
-        if (best_pos != -1) {
-            // Clear old position
-            for (int i = file_start; i < file_start + file_size; i++) {
-                disk[i] = -1;
-            }
-            
-            // Place at new position
-            for (int i = 0; i < file_size; i++) {
-                disk[best_pos + i] = file_id;
-            }
+        Segment span = heaps[best].items[0];
+        span_heap_pop(&heaps[best]);
+        f->start = span.start;
+        if (span.length > f->length) {
+            Segment rest = {span.start + f->length, span.length - f->length};
+            span_heap_push(&heaps[span_bucket(rest.length)], rest);
         }
     }
+    
+    for (int len = 1; len <= LONG_SPAN; len++) {
+        free(heaps[len].items);
+    }
 }
 
-long part2(InputData* data) {
-    // Create a copy of the disk
-    int* disk = malloc(data->size * sizeof(int));
-    memcpy(disk, data->disk, data->size * sizeof(int));
+uint128_t part2(InputData* data) {
+    Segment* files = malloc(data->file_count * sizeof(Segment));
+    memcpy(files, data->files, data->file_count * sizeof(Segment));
     
-    // Compact the disk (whole files)
-    compact_disk_part2(disk, data->size, data->input, data->input_len);
+    compact_disk_part2(files, data->file_count, data->spans, data->span_count);
     
     // Calculate checksum
-    long checksum = calculate_checksum(disk, data->size);
+    uint128_t checksum = 0;
+    for (size_t file_id = 0; file_id < data->file_count; file_id++) {
+        checksum += run_checksum(file_id, files[file_id].start, files[file_id].length);
+    }
     
-    free(disk);
+    free(files);
     return checksum;
 }
 
 int main(int argc, char* argv[]) {
-    const char* input_file = (argc > 1 && strcmp(argv[1], "test") == 0) 
-        ? "inputs/day09_test.txt" 
-        : "inputs/day09.txt";
+    const char* input_file = "inputs/day09.txt";
+    bool stream = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "test") == 0) {
+            input_file = "inputs/day09_test.txt";
+        } else if (strcmp(argv[i], "stream") == 0) {
+            stream = true;
+        }
+    }
+    
+    // Streaming mode: part 1 only, for disk maps too large to index
+    if (stream) {
+        DiskMap map;
+        if (!disk_map_open(input_file, &map)) {
+            perror("Error opening file");
+            return 1;
+        }
+        print_uint128("Part 1", stream_part1(&map));
+        disk_map_close(&map);
+        return 0;
+    }
     
     InputData* data = parse_input(input_file);
     if (!data) {
@@ -212,13 +293,14 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    print_uint128("Part 1", part1(data));
+    print_uint128("Part 2", part2(data));
     
     // Free allocated memory
-    free(data->disk);
-    free(data->input);
+    disk_map_close(&data->map);
+    free(data->files);
+    free(data->spans);
     free(data);
     
     return 0;
-}
\ No newline at end of file
+}
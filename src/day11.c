@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
@@ -43,178 +47,387 @@ InputData* parse_input(const char* filename) {
     return data;
 }
 
-// Count digits in a number
-int count_digits(long num) {
-    if (num == 0) return 1;
-    int count = 0;
-    while (num > 0) {
-        count++;
-        num /= 10;
+// Open-addressing map from stone value to how many stones carry it.
+// Capacity is a power of two; EMPTY_STONE marks a free slot.
+#define EMPTY_STONE (-1L)
+
+typedef struct {
+    long* keys;
+    long* counts;
+    size_t capacity;
+    size_t size;
+} StoneMap;
+
+void stone_map_init(StoneMap* map, size_t capacity) {
+    map->capacity = capacity;
+    map->size = 0;
+    map->keys = malloc(capacity * sizeof(long));
+    map->counts = malloc(capacity * sizeof(long));
+    memset(map->keys, 0xff, capacity * sizeof(long)); // all EMPTY_STONE
+}
+
+void stone_map_free(StoneMap* map) {
+    free(map->keys);
+    free(map->counts);
+}
+
+void stone_map_clear(StoneMap* map) {
+    memset(map->keys, 0xff, map->capacity * sizeof(long));
+    map->size = 0;
+}
+
+static inline size_t stone_slot(const StoneMap* map, long stone) {
+    unsigned long h = (unsigned long)stone * 0x9E3779B97F4A7C15UL;
+    return (h ^ (h >> 29)) & (map->capacity - 1);
+}
+
+void stone_map_add(StoneMap* map, long stone, long count);
+
+// Look up a stone's count; returns false if the stone is absent
+bool stone_map_get(const StoneMap* map, long stone, long* count) {
+    size_t i = stone_slot(map, stone);
+    while (map->keys[i] != EMPTY_STONE) {
+        if (map->keys[i] == stone) {
+            *count = map->counts[i];
+            return true;
+        }
+        i = (i + 1) & (map->capacity - 1);
+    }
+    return false;
+}
+
+// Double the capacity and reinsert, keeping the load factor under 1/2
+void stone_map_grow(StoneMap* map) {
+    StoneMap bigger;
+    stone_map_init(&bigger, map->capacity * 2);
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->keys[i] != EMPTY_STONE) {
+            stone_map_add(&bigger, map->keys[i], map->counts[i]);
+        }
     }
-    return count;
+    stone_map_free(map);
+    *map = bigger;
 }
 
-// Split a number with even digits into two parts
-void split_number(long num, long* left, long* right) {
-    int digits = count_digits(num);
-    int half = digits / 2;
+void stone_map_add(StoneMap* map, long stone, long count) {
+    if (2 * (map->size + 1) > map->capacity) {
+        stone_map_grow(map);
+    }
     
-    long divisor = 1;
-    for (int i = 0; i < half; i++) {
-        divisor *= 10;
+    size_t i = stone_slot(map, stone);
+    while (map->keys[i] != EMPTY_STONE && map->keys[i] != stone) {
+        i = (i + 1) & (map->capacity - 1);
     }
     
-    *right = num % divisor;
-    *left = num / divisor;
+    if (map->keys[i] == EMPTY_STONE) {
+        map->keys[i] = stone;
+        map->counts[i] = 0;
+        map->size++;
+    }
+    map->counts[i] += count;
 }
 
-// Simulate one blink
-long* blink(long* stones, int count, int* new_count) {
-    // Allocate more space to be safe
-    long* new_stones = malloc(sizeof(long) * count * 3);
-    if (!new_stones) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(1);
-    }
-    int idx = 0;
+// Advance the whole population by one blink, writing into `next`
+void blink(const StoneMap* curr, StoneMap* next) {
+    stone_map_clear(next);
     
-    for (int i = 0; i < count; i++) {
-        if (stones[i] == 0) {
-            new_stones[idx++] = 1;
-        } else if (count_digits(stones[i]) % 2 == 0) {
-            long left, right;
-            split_number(stones[i], &left, &right);
-            new_stones[idx++] = left;
-            new_stones[idx++] = right;
+    for (size_t i = 0; i < curr->capacity; i++) {
+        long stone = curr->keys[i];
+        if (stone == EMPTY_STONE) continue;
+        long count = curr->counts[i];
+        
+        int digits = count_digits(stone);
+        if (stone == 0) {
+            stone_map_add(next, 1, count);
+        } else if (digits % 2 == 0) {
+            uint64_t left, right;
+            split_digits(stone, digits / 2, &left, &right);
+            stone_map_add(next, left, count);
+            stone_map_add(next, right, count);
         } else {
-            new_stones[idx++] = stones[i] * 2024;
+            stone_map_add(next, stone * 2024, count);
         }
     }
-    
-    *new_count = idx;
-    return new_stones;
 }
 
-long part1(InputData* data) {
-    // Make a copy of the stones
-    long* stones = malloc(sizeof(long) * data->count);
-    memcpy(stones, data->stones, sizeof(long) * data->count);
-    int count = data->count;
-    
-    // Simulate 25 blinks
-    for (int i = 0; i < 25; i++) {
-        int new_count;
-        long* new_stones = blink(stones, count, &new_count);
-        free(stones);
-        stones = new_stones;
-        count = new_count;
-        
+// Count stones after the given number of blinks. Only distinct values are
+// tracked, so memory is bounded by the number of distinct stones.
+long count_stones(InputData* data, int blinks) {
+    StoneMap maps[2];
+    stone_map_init(&maps[0], 1024);
+    stone_map_init(&maps[1], 1024);
+    
+    for (int i = 0; i < data->count; i++) {
+        stone_map_add(&maps[0], data->stones[i], 1);
+    }
+    
+    int curr = 0;
+    for (int b = 0; b < blinks; b++) {
+        blink(&maps[curr], &maps[1 - curr]);
+        curr = 1 - curr;
+    }
+    
+    long total = 0;
+    for (size_t i = 0; i < maps[curr].capacity; i++) {
+        if (maps[curr].keys[i] != EMPTY_STONE) {
+            total += maps[curr].counts[i];
+        }
     }
     
-    free(stones);
-    return count;
+    stone_map_free(&maps[0]);
+    stone_map_free(&maps[1]);
+    return total;
 }
 
-// Memoization cache for counting stones
-typedef struct CacheEntry {
-    long stone;
-    int blinks;
-    long count;
-    struct CacheEntry* next;
-} CacheEntry;
-
-#define CACHE_SIZE 100000
-CacheEntry* cache[CACHE_SIZE];
-
-// Hash function for cache
-unsigned int hash(long stone, int blinks) {
-    unsigned long long key = ((unsigned long long)stone << 32) | blinks;
-    return (key ^ (key >> 16) ^ (key >> 32)) % CACHE_SIZE;
-}
+// The closed set of stone values reachable from the input, compiled into a
+// sparse transition matrix: row id has one entry per successor of the stone
+// (one or two), so one blink is one sparse matrix-vector product.
+typedef struct {
+    long* values;   // values[id]
+    int* next;      // next[2 * id], next[2 * id + 1]; the second is -1 if the stone does not split
+    long* initial;  // initial[id]: stones with this value in the input
+    int size;
+} StoneGraph;
 
-// Get from cache
-long cache_get(long stone, int blinks) {
-    unsigned int idx = hash(stone, blinks);
-    CacheEntry* entry = cache[idx];
-    while (entry) {
-        if (entry->stone == stone && entry->blinks == blinks) {
-            return entry->count;
+// Discover every reachable value breadth-first, giving each a dense id
+StoneGraph* compile_stone_graph(InputData* data) {
+    StoneGraph* g = malloc(sizeof(StoneGraph));
+    int capacity = 1024;
+    g->values = malloc(capacity * sizeof(long));
+    g->size = 0;
+    
+    StoneMap ids; // value -> id
+    stone_map_init(&ids, 1024);
+    
+    for (int i = 0; i < data->count; i++) {
+        long id;
+        if (!stone_map_get(&ids, data->stones[i], &id)) {
+            stone_map_add(&ids, data->stones[i], g->size);
+            g->values[g->size++] = data->stones[i];
+        }
+    }
+    
+    g->next = malloc(2 * capacity * sizeof(int));
+    for (int id = 0; id < g->size; id++) {
+        long stone = g->values[id];
+        long succ[2] = {-1, -1};
+        int digits = count_digits(stone);
+        
+        if (stone == 0) {
+            succ[0] = 1;
+        } else if (digits % 2 == 0) {
+            uint64_t left, right;
+            split_digits(stone, digits / 2, &left, &right);
+            succ[0] = left;
+            succ[1] = right;
+        } else {
+            succ[0] = stone * 2024;
+        }
+        
+        for (int k = 0; k < 2; k++) {
+            g->next[2 * id + k] = -1;
+            if (succ[k] < 0) continue;
+            
+            long succ_id;
+            if (!stone_map_get(&ids, succ[k], &succ_id)) {
+                if (g->size >= capacity) {
+                    capacity *= 2;
+                    g->values = realloc(g->values, capacity * sizeof(long));
+                    g->next = realloc(g->next, 2 * capacity * sizeof(int));
+                }
+                succ_id = g->size;
+                stone_map_add(&ids, succ[k], succ_id);
+                g->values[g->size++] = succ[k];
+            }
+            g->next[2 * id + k] = succ_id;
         }
-        entry = entry->next;
     }
-    return -1; // Not found
+    
+    g->initial = calloc(g->size, sizeof(long));
+    for (int i = 0; i < data->count; i++) {
+        long id = 0;
+        stone_map_get(&ids, data->stones[i], &id);
+        g->initial[id]++;
+    }
+    
+    stone_map_free(&ids);
+    return g;
+}
+
+void stone_graph_free(StoneGraph* g) {
+    free(g->values);
+    free(g->next);
+    free(g->initial);
+    free(g);
 }
 
-// Put in cache
-void cache_put(long stone, int blinks, long count) {
-    unsigned int idx = hash(stone, blinks);
-    CacheEntry* entry = malloc(sizeof(CacheEntry));
-    entry->stone = stone;
-    entry->blinks = blinks;
-    entry->count = count;
-    entry->next = cache[idx];
-    cache[idx] = entry;
+uint64_t pow_mod(uint64_t base, uint64_t exp, uint64_t mod) {
+    uint64_t result = 1;
+    base %= mod;
+    while (exp > 0) {
+        if (exp & 1) result = result * base % mod;
+        base = base * base % mod;
+        exp >>= 1;
+    }
+    return result;
 }
 
-// Clear cache
-void cache_clear() {
-    for (int i = 0; i < CACHE_SIZE; i++) {
-        CacheEntry* entry = cache[i];
-        while (entry) {
-            CacheEntry* next = entry->next;
-            free(entry);
-            entry = next;
+// Multiply polynomials a and b (degree < len) modulo x^len - rec(x), where
+// x^len = rec[0] x^(len-1) + rec[1] x^(len-2) + ... + rec[len-1]
+void poly_mul_mod(const uint64_t* a, const uint64_t* b, uint64_t* out, const uint64_t* rec, int len, uint64_t mod) {
+    uint64_t* prod = calloc(2 * len, sizeof(uint64_t));
+    for (int i = 0; i < len; i++) {
+        if (a[i] == 0) continue;
+        for (int j = 0; j < len; j++) {
+            prod[i + j] = (prod[i + j] + a[i] * b[j]) % mod;
+        }
+    }
+    for (int k = 2 * len - 2; k >= len; k--) {
+        if (prod[k] == 0) continue;
+        for (int i = 0; i < len; i++) {
+            prod[k - 1 - i] = (prod[k - 1 - i] + prod[k] * rec[i]) % mod;
         }
-        cache[i] = NULL;
     }
+    memcpy(out, prod, len * sizeof(uint64_t));
+    free(prod);
 }
 
-// Count stones after n blinks using memoization
-long count_stones(long stone, int blinks) {
-    if (blinks == 0) {
-        return 1;
+// Number of stones after `blinks` blinks, modulo the prime `mod`, in
+// O(log blinks) squaring steps.
+//
+// Squaring the V x V transition matrix directly costs O(V^3) per step, and
+// the matrix fills in after a few dozen blinks. Instead, 2V sparse steps give
+// the count sequence s_0 .. s_{2V-1}, Berlekamp-Massey finds its shortest
+// linear recurrence (of order L <= V), and x^blinks is raised by squaring in
+// the ring of polynomials modulo that recurrence, which is the same as
+// powering its L x L companion matrix at O(L^2) per step.
+uint64_t count_stones_mod(StoneGraph* g, uint64_t blinks, uint64_t mod) {
+    int terms = 2 * g->size;
+    uint64_t* seq = malloc(terms * sizeof(uint64_t));
+    uint64_t* f = malloc(g->size * sizeof(uint64_t));
+    uint64_t* f_next = malloc(g->size * sizeof(uint64_t));
+    
+    // f[id] = stones after n blinks starting from one stone `id`
+    for (int id = 0; id < g->size; id++) f[id] = 1;
+    for (int n = 0; n < terms; n++) {
+        uint64_t total = 0;
+        for (int id = 0; id < g->size; id++) {
+            total = (total + g->initial[id] % mod * f[id]) % mod;
+        }
+        seq[n] = total;
+        
+        for (int id = 0; id < g->size; id++) {
+            uint64_t v = f[g->next[2 * id]];
+            if (g->next[2 * id + 1] >= 0) v += f[g->next[2 * id + 1]];
+            f_next[id] = v % mod;
+        }
+        uint64_t* tmp = f; f = f_next; f_next = tmp;
     }
+    free(f);
+    free(f_next);
+    
+    if (blinks < (uint64_t)terms) {
+        uint64_t result = seq[blinks];
+        free(seq);
+        return result;
+    }
+    
+    // Berlekamp-Massey: s_n = rec[0] s_{n-1} + ... + rec[len-1] s_{n-len}
+    uint64_t* rec = calloc(terms + 1, sizeof(uint64_t));
+    uint64_t* prev = calloc(terms + 1, sizeof(uint64_t));
+    uint64_t* tmp = calloc(terms + 1, sizeof(uint64_t));
+    int len = 0, prev_len = 0, shift = 1;
+    uint64_t prev_delta = 1;
     
-    // Check cache
-    long cached = cache_get(stone, blinks);
-    if (cached != -1) {
-        return cached;
+    for (int n = 0; n < terms; n++) {
+        uint64_t delta = seq[n];
+        for (int i = 0; i < len; i++) {
+            delta = (delta + mod - rec[i] * seq[n - 1 - i] % mod) % mod;
+        }
+        if (delta == 0) {
+            shift++;
+            continue;
+        }
+        
+        uint64_t coef = delta * pow_mod(prev_delta, mod - 2, mod) % mod;
+        memcpy(tmp, rec, (terms + 1) * sizeof(uint64_t));
+        int tmp_len = len;
+        
+        // rec -= coef * x^shift * (1 - prev) in connection-polynomial form
+        rec[shift - 1] = (rec[shift - 1] + coef) % mod;
+        for (int i = 0; i < prev_len; i++) {
+            rec[shift + i] = (rec[shift + i] + mod - coef * prev[i] % mod) % mod;
+        }
+        
+        if (2 * len <= n) {
+            len = n + 1 - len;
+            memcpy(prev, tmp, (terms + 1) * sizeof(uint64_t));
+            prev_len = tmp_len;
+            prev_delta = delta;
+            shift = 1;
+        } else {
+            shift++;
+        }
     }
+    free(prev);
+    free(tmp);
     
-    long result;
-    if (stone == 0) {
-        result = count_stones(1, blinks - 1);
-    } else if (count_digits(stone) % 2 == 0) {
-        long left, right;
-        split_number(stone, &left, &right);
-        result = count_stones(left, blinks - 1) + count_stones(right, blinks - 1);
-    } else {
-        result = count_stones(stone * 2024, blinks - 1);
+    uint64_t result = 0;
+    if (len > 0) {
+        // x^blinks mod the recurrence, by square-and-multiply
+        uint64_t* power = calloc(len, sizeof(uint64_t));
+        uint64_t* base = calloc(len, sizeof(uint64_t));
+        power[0] = 1;
+        if (len == 1) base[0] = rec[0];
+        else base[1] = 1;
+        
+        for (uint64_t e = blinks; e > 0; e >>= 1) {
+            if (e & 1) poly_mul_mod(power, base, power, rec, len, mod);
+            if (e > 1) poly_mul_mod(base, base, base, rec, len, mod);
+        }
+        
+        // s_blinks = sum of power[i] * s_i
+        for (int i = 0; i < len; i++) {
+            result = (result + power[i] * seq[i]) % mod;
+        }
+        free(power);
+        free(base);
     }
     
-    cache_put(stone, blinks, result);
+    free(rec);
+    free(seq);
     return result;
 }
 
+long part1(InputData* data) {
+    return count_stones(data, 25);
+}
+
 long part2(InputData* data) {
-    // Clear cache from any previous runs
-    memset(cache, 0, sizeof(cache));
-    
-    long total = 0;
-    for (int i = 0; i < data->count; i++) {
-        total += count_stones(data->stones[i], 75);
-    }
-    
-    // Clean up cache
-    cache_clear();
-    
-    return total;
+    return count_stones(data, 75);
 }
 
 int main(int argc, char* argv[]) {
-    const char* input_file = (argc > 1 && strcmp(argv[1], "test") == 0) 
-        ? "inputs/day11_test.txt" 
-        : "inputs/day11.txt";
+    const char* input_file = "inputs/day11.txt";
+    bool have_blinks = false;
+    uint64_t blinks = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "test") == 0) {
+            input_file = "inputs/day11_test.txt";
+            continue;
+        }
+        
+        // Anything else must be a plain non-negative blink count
+        char* end;
+        errno = 0;
+        blinks = strtoull(argv[i], &end, 10);
+        if (argv[i][0] < '0' || argv[i][0] > '9' || *end || errno == ERANGE) {
+            fprintf(stderr, "Invalid blink count: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [test] [blinks]\n", argv[0]);
+            return 1;
+        }
+        have_blinks = true;
+    }
     
     InputData* data = parse_input(input_file);
     if (!data) {
@@ -225,6 +438,14 @@ int main(int argc, char* argv[]) {
     printf("Part 1: %ld\n", part1(data));
     printf("Part 2: %ld\n", part2(data));
     
+    // Optional extra query: stones after any number of blinks, e.g. 1000000000
+    if (have_blinks) {
+        const uint64_t mod = 1000000007;
+        StoneGraph* g = compile_stone_graph(data);
+        printf("Blinks %" PRIu64 " (mod %" PRIu64 "): %" PRIu64 "\n", blinks, mod, count_stones_mod(g, blinks, mod));
+        stone_graph_free(g);
+    }
+    
     // Free allocated memory
     free(data->stones);
     free(data);
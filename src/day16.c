@@ -6,12 +6,11 @@
 #include <string.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
-#define MAX_SIZE 200
-
 typedef enum {
     NORTH = 0,
     EAST = 1,
@@ -20,322 +19,294 @@ typedef enum {
 } Direction;
 
 typedef struct {
-    int row, col;
-    Direction dir;
-} State;
-
-typedef struct {
-    char grid[MAX_SIZE][MAX_SIZE];
+    char* grid; // rows * cols, row-major
     int rows, cols;
     int start_row, start_col;
     int end_row, end_col;
 } InputData;
 
 InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* content = read_file(filename);
+    if (!content) {
         perror("Error opening file");
         return NULL;
     }
     
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
+        free(content);
         return NULL;
     }
     
+    // Size the grid from the first line and the line count
+    data->cols = strcspn(content, "\n");
     data->rows = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        int len = strlen(line);
-        if (line[len-1] == '\n') line[len-1] = '\0';
-        
-        strcpy(data->grid[data->rows], line);
-        data->cols = strlen(line);
-        
-        // Find start and end positions
-        for (int c = 0; c < data->cols; c++) {
-            if (data->grid[data->rows][c] == 'S') {
-                data->start_row = data->rows;
-                data->start_col = c;
-            } else if (data->grid[data->rows][c] == 'E') {
-                data->end_row = data->rows;
-                data->end_col = c;
+    for (char* p = content; *p; ) {
+        char* eol = strchr(p, '\n');
+        if (eol != p) data->rows++;
+        if (!eol) break;
+        p = eol + 1;
+    }
+    
+    data->grid = malloc((size_t)data->rows * data->cols);
+    if (!data->grid) {
+        free(content);
+        free(data);
+        return NULL;
+    }
+    
+    int row = 0;
+    for (char* p = content; *p && row < data->rows; ) {
+        int len = strcspn(p, "\n");
+        if (len > 0) {
+            char* dst = data->grid + (size_t)row * data->cols;
+            memset(dst, '#', data->cols);
+            memcpy(dst, p, len < data->cols ? len : data->cols);
+            
+            // Find start and end positions
+            for (int c = 0; c < data->cols; c++) {
+                if (dst[c] == 'S') {
+                    data->start_row = row;
+                    data->start_col = c;
+                } else if (dst[c] == 'E') {
+                    data->end_row = row;
+                    data->end_col = c;
+                }
             }
+            row++;
         }
-        
-        data->rows++;
+        p += len;
+        if (*p == '\n') p++;
     }
     
-    fclose(file);
+    free(content);
     return data;
 }
 
-// Dijkstra's algorithm for finding shortest path with rotation costs
-long part1(InputData* data) {
-    // Cost array: [row][col][direction]
-    int cost[MAX_SIZE][MAX_SIZE][4];
-    bool visited[MAX_SIZE][MAX_SIZE][4];
-    
-    // Initialize costs to infinity
-    for (int r = 0; r < data->rows; r++) {
-        for (int c = 0; c < data->cols; c++) {
-            for (int d = 0; d < 4; d++) {
-                cost[r][c][d] = INT_MAX;
-                visited[r][c][d] = false;
-            }
-        }
+// Direction vectors: North, East, South, West
+int dr[] = {-1, 0, 1, 0};
+int dc[] = {0, 1, 0, -1};
+
+#define UNREACHED UINT32_MAX
+
+// Search state in structure-of-arrays form: a 32-bit cost and a visited bit
+// per (row, col, dir) state, with state = (row * cols + col) * 4 + dir.
+// About 4.1 bytes per state, so a 5000x5000 maze needs ~410 MB plus the heap.
+typedef struct {
+    uint32_t* cost;
+    uint64_t* visited;
+    uint32_t num_states;
+} SearchState;
+
+bool search_state_init(SearchState* st, const InputData* data) {
+    st->num_states = (uint32_t)data->rows * data->cols * 4;
+    st->cost = malloc((size_t)st->num_states * sizeof(uint32_t));
+    st->visited = calloc(((size_t)st->num_states + 63) / 64, sizeof(uint64_t));
+    if (!st->cost || !st->visited) {
+        free(st->cost);
+        free(st->visited);
+        return false;
+    }
+    return true;
+}
+
+void search_state_free(SearchState* st) {
+    free(st->cost);
+    free(st->visited);
+}
+
+static inline bool is_visited(const SearchState* st, uint32_t state) {
+    return (st->visited[state >> 6] >> (state & 63)) & 1;
+}
+
+// The four orientations of a cell share one nibble of the visited bitset
+static inline bool tile_visited(const SearchState* st, uint32_t cell) {
+    return (st->visited[cell >> 4] >> ((cell & 15) * 4)) & 0xF;
+}
+
+static inline void set_visited(SearchState* st, uint32_t state) {
+    st->visited[state >> 6] |= 1ULL << (state & 63);
+}
+
+// Min-heap of (cost, state) for Dijkstra
+typedef struct {
+    uint32_t cost;
+    uint32_t state;
+} HeapEntry;
+
+typedef struct {
+    HeapEntry* items;
+    size_t size;
+    size_t capacity;
+} MinHeap;
+
+void heap_push(MinHeap* heap, uint32_t cost, uint32_t state) {
+    if (heap->size >= heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 1024;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(HeapEntry));
     }
     
-    // Start facing East
-    cost[data->start_row][data->start_col][EAST] = 0;
-    
-    // Direction vectors: North, East, South, West
-    int dr[] = {-1, 0, 1, 0};
-    int dc[] = {0, 1, 0, -1};
+    size_t i = heap->size++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap->items[parent].cost <= cost) break;
+        heap->items[i] = heap->items[parent];
+        i = parent;
+    }
+    heap->items[i] = (HeapEntry){cost, state};
+}
+
+HeapEntry heap_pop(MinHeap* heap) {
+    HeapEntry top = heap->items[0];
+    HeapEntry last = heap->items[--heap->size];
     
-    // Priority queue implemented with simple array (for small grid)
+    size_t i = 0;
     while (true) {
-        // Find minimum cost unvisited state
-        int min_cost = INT_MAX;
-        int min_r = -1, min_c = -1, min_d = -1;
-        
-        for (int r = 0; r < data->rows; r++) {
-            for (int c = 0; c < data->cols; c++) {
-                for (int d = 0; d < 4; d++) {
-                    if (!visited[r][c][d] && cost[r][c][d] < min_cost) {
-                        min_cost = cost[r][c][d];
-                        min_r = r;
-                        min_c = c;
-                        min_d = d;
-                    }
-                }
-            }
-        }
-        
-        if (min_r == -1) break; // No more reachable states
-        
-        visited[min_r][min_c][min_d] = true;
-        
-        // Try moving forward
-        int new_r = min_r + dr[min_d];
-        int new_c = min_c + dc[min_d];
-        if (new_r >= 0 && new_r < data->rows && new_c >= 0 && new_c < data->cols &&
-            data->grid[new_r][new_c] != '#') {
-            int new_cost = min_cost + 1;
-            if (new_cost < cost[new_r][new_c][min_d]) {
-                cost[new_r][new_c][min_d] = new_cost;
-            }
-        }
-        
-        // Try rotating clockwise
-        int cw_dir = (min_d + 1) % 4;
-        int cw_cost = min_cost + 1000;
-        if (cw_cost < cost[min_r][min_c][cw_dir]) {
-            cost[min_r][min_c][cw_dir] = cw_cost;
-        }
-        
-        // Try rotating counter-clockwise
-        int ccw_dir = (min_d + 3) % 4;
-        int ccw_cost = min_cost + 1000;
-        if (ccw_cost < cost[min_r][min_c][ccw_dir]) {
-            cost[min_r][min_c][ccw_dir] = ccw_cost;
-        }
+        size_t child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && heap->items[child + 1].cost < heap->items[child].cost) child++;
+        if (heap->items[child].cost >= last.cost) break;
+        heap->items[i] = heap->items[child];
+        i = child;
     }
+    if (heap->size > 0) heap->items[i] = last;
     
-    // Find minimum cost at end position
-    int min_end_cost = INT_MAX;
-    for (int d = 0; d < 4; d++) {
-        if (cost[data->end_row][data->end_col][d] < min_end_cost) {
-            min_end_cost = cost[data->end_row][data->end_col][d];
-        }
+    return top;
+}
+
+// Relax a state reached at new_cost, queueing it if it improved
+void relax(MinHeap* heap, uint32_t* cost, uint32_t state, uint32_t new_cost) {
+    if (new_cost < cost[state]) {
+        cost[state] = new_cost;
+        heap_push(heap, new_cost, state);
     }
-    
-    return min_end_cost;
 }
 
-// Part 2: Count all tiles that are part of any optimal path
-long part2(InputData* data) {
-    // First, find the minimum cost using same algorithm as part 1
-    int cost[MAX_SIZE][MAX_SIZE][4];
-    bool visited[MAX_SIZE][MAX_SIZE][4];
+// Cell one step from `cell` in direction d (backwards if step is -1), or -1
+// if that is outside the maze or a wall
+static inline long step_cell(const InputData* data, long cell, int d, int step) {
+    int r = cell / data->cols + step * dr[d];
+    int c = cell % data->cols + step * dc[d];
+    if (r < 0 || r >= data->rows || c < 0 || c >= data->cols) return -1;
+    long next = (long)r * data->cols + c;
+    return data->grid[next] == '#' ? -1 : next;
+}
+
+// Dijkstra over (row, col, dir) states from the given sources. With reverse
+// set, moves are followed backwards, so cost[] becomes the cheapest cost from
+// each state to any source.
+void dijkstra(const InputData* data, SearchState* st, const uint32_t* sources, int num_sources, bool reverse) {
+    MinHeap heap = {NULL, 0, 0};
     
-    // Initialize costs to infinity
-    for (int r = 0; r < data->rows; r++) {
-        for (int c = 0; c < data->cols; c++) {
-            for (int d = 0; d < 4; d++) {
-                cost[r][c][d] = INT_MAX;
-                visited[r][c][d] = false;
-            }
-        }
+    for (uint32_t i = 0; i < st->num_states; i++) {
+        st->cost[i] = UNREACHED;
+    }
+    memset(st->visited, 0, ((size_t)st->num_states + 63) / 64 * sizeof(uint64_t));
+    for (int i = 0; i < num_sources; i++) {
+        relax(&heap, st->cost, sources[i], 0);
     }
     
-    // Start facing East
-    cost[data->start_row][data->start_col][EAST] = 0;
-    
-    // Direction vectors: North, East, South, West
-    int dr[] = {-1, 0, 1, 0};
-    int dc[] = {0, 1, 0, -1};
+    int step = reverse ? -1 : 1;
     
-    // Run Dijkstra's algorithm
-    while (true) {
-        int min_cost = INT_MAX;
-        int min_r = -1, min_c = -1, min_d = -1;
-        
-        for (int r = 0; r < data->rows; r++) {
-            for (int c = 0; c < data->cols; c++) {
-                for (int d = 0; d < 4; d++) {
-                    if (!visited[r][c][d] && cost[r][c][d] < min_cost) {
-                        min_cost = cost[r][c][d];
-                        min_r = r;
-                        min_c = c;
-                        min_d = d;
-                    }
-                }
-            }
-        }
-        
-        if (min_r == -1) break;
-        
-        visited[min_r][min_c][min_d] = true;
+    while (heap.size > 0) {
+        HeapEntry entry = heap_pop(&heap);
+        if (is_visited(st, entry.state)) continue;
+        set_visited(st, entry.state);
         
-        // Try moving forward
-        int new_r = min_r + dr[min_d];
-        int new_c = min_c + dc[min_d];
-        if (new_r >= 0 && new_r < data->rows && new_c >= 0 && new_c < data->cols &&
-            data->grid[new_r][new_c] != '#') {
-            int new_cost = min_cost + 1;
-            if (new_cost < cost[new_r][new_c][min_d]) {
-                cost[new_r][new_c][min_d] = new_cost;
-            }
-        }
+        uint32_t cell = entry.state / 4;
+        int d = entry.state % 4;
         
-        // Try rotating clockwise
-        int cw_dir = (min_d + 1) % 4;
-        int cw_cost = min_cost + 1000;
-        if (cw_cost < cost[min_r][min_c][cw_dir]) {
-            cost[min_r][min_c][cw_dir] = cw_cost;
+        // Step forward (or backward when searching in reverse)
+        long next = step_cell(data, cell, d, step);
+        if (next >= 0) {
+            relax(&heap, st->cost, (uint32_t)next * 4 + d, entry.cost + 1);
         }
         
-        // Try rotating counter-clockwise
-        int ccw_dir = (min_d + 3) % 4;
-        int ccw_cost = min_cost + 1000;
-        if (ccw_cost < cost[min_r][min_c][ccw_dir]) {
-            cost[min_r][min_c][ccw_dir] = ccw_cost;
-        }
+        // Rotations are symmetric, so they are the same in both directions
+        relax(&heap, st->cost, cell * 4 + (d + 1) % 4, entry.cost + 1000);
+        relax(&heap, st->cost, cell * 4 + (d + 3) % 4, entry.cost + 1000);
     }
     
-    // Find minimum cost at end position
-    int min_end_cost = INT_MAX;
-    for (int d = 0; d < 4; d++) {
-        if (cost[data->end_row][data->end_col][d] < min_end_cost) {
-            min_end_cost = cost[data->end_row][data->end_col][d];
-        }
-    }
-    
-    // Now backtrack from all end states with minimum cost to find all optimal paths
-    bool on_optimal_path[MAX_SIZE][MAX_SIZE];
-    for (int r = 0; r < data->rows; r++) {
-        for (int c = 0; c < data->cols; c++) {
-            on_optimal_path[r][c] = false;
-        }
+    free(heap.items);
+}
+
+typedef struct {
+    long best_cost;
+    long best_tiles;
+} MazeResult;
+
+// Solve both parts with one backward search from every orientation at E.
+// A state s lies on an optimal path exactly when fwd(s) + bwd(s) == best.
+// Along optimal paths fwd(s) is simply best - bwd(s), so instead of a second
+// cost array the forward side walks from S over the edges where
+// bwd(s) == weight + bwd(next), which are exactly the edges of optimal paths.
+MazeResult solve(const InputData* data) {
+    MazeResult result = {-1, 0};
+    SearchState st;
+    if (!search_state_init(&st, data)) {
+        fprintf(stderr, "Not enough memory for a %dx%d maze\n", data->rows, data->cols);
+        return result;
     }
     
-    // Queue for BFS backtracking
-    State queue[MAX_SIZE * MAX_SIZE * 4];
-    int queue_size = 0;
+    uint32_t end_cell = (uint32_t)data->end_row * data->cols + data->end_col;
+    uint32_t ends[4] = {end_cell * 4, end_cell * 4 + 1, end_cell * 4 + 2, end_cell * 4 + 3};
+    dijkstra(data, &st, ends, 4, true);
     
-    // Add all end states with minimum cost
-    for (int d = 0; d < 4; d++) {
-        if (cost[data->end_row][data->end_col][d] == min_end_cost) {
-            queue[queue_size].row = data->end_row;
-            queue[queue_size].col = data->end_col;
-            queue[queue_size].dir = d;
-            queue_size++;
-            on_optimal_path[data->end_row][data->end_col] = true;
-        }
+    // Start facing East
+    uint32_t start = ((uint32_t)data->start_row * data->cols + data->start_col) * 4 + EAST;
+    const uint32_t* bwd = st.cost;
+    if (bwd[start] == UNREACHED) {
+        search_state_free(&st);
+        return result;
     }
+    result.best_cost = bwd[start];
     
-    // Backtrack through all optimal paths
-    for (int i = 0; i < queue_size; i++) {
-        int r = queue[i].row;
-        int c = queue[i].col;
-        int d = queue[i].dir;
-        int current_cost = cost[r][c][d];
-        
-        // Check if we could have come from moving forward
-        int prev_r = r - dr[d];
-        int prev_c = c - dc[d];
-        if (prev_r >= 0 && prev_r < data->rows && prev_c >= 0 && prev_c < data->cols &&
-            data->grid[prev_r][prev_c] != '#' && cost[prev_r][prev_c][d] == current_cost - 1) {
-            on_optimal_path[prev_r][prev_c] = true;
-            // Add to queue if not already processed
-            bool found = false;
-            for (int j = 0; j < queue_size; j++) {
-                if (queue[j].row == prev_r && queue[j].col == prev_c && queue[j].dir == (Direction)d) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                queue[queue_size].row = prev_r;
-                queue[queue_size].col = prev_c;
-                queue[queue_size].dir = d;
-                queue_size++;
-            }
-        }
+    // Reuse the visited bits to mark optimal states, and count a tile the
+    // first time any of its orientations is marked
+    memset(st.visited, 0, ((size_t)st.num_states + 63) / 64 * sizeof(uint64_t));
+    size_t stack_capacity = 1024;
+    uint32_t* stack = malloc(stack_capacity * sizeof(uint32_t));
+    size_t top = 0;
+    stack[top++] = start;
+    set_visited(&st, start);
+    result.best_tiles = 1;
+    
+    while (top > 0) {
+        uint32_t state = stack[--top];
+        uint32_t cell = state / 4;
+        int d = state % 4;
         
-        // Check if we could have come from rotating
-        // Clockwise rotation
-        int from_dir_cw = (d + 3) % 4; // Reverse of clockwise
-        if (cost[r][c][from_dir_cw] == current_cost - 1000) {
-            on_optimal_path[r][c] = true;
-            bool found = false;
-            for (int j = 0; j < queue_size; j++) {
-                if (queue[j].row == r && queue[j].col == c && queue[j].dir == (Direction)from_dir_cw) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                queue[queue_size].row = r;
-                queue[queue_size].col = c;
-                queue[queue_size].dir = from_dir_cw;
-                queue_size++;
-            }
+        uint32_t next_states[3];
+        uint32_t weights[3];
+        int num_next = 0;
+        long next = step_cell(data, cell, d, 1);
+        if (next >= 0) {
+            next_states[num_next] = (uint32_t)next * 4 + d;
+            weights[num_next++] = 1;
         }
+        next_states[num_next] = cell * 4 + (d + 1) % 4;
+        weights[num_next++] = 1000;
+        next_states[num_next] = cell * 4 + (d + 3) % 4;
+        weights[num_next++] = 1000;
         
-        // Counter-clockwise rotation
-        int from_dir_ccw = (d + 1) % 4; // Reverse of counter-clockwise
-        if (cost[r][c][from_dir_ccw] == current_cost - 1000) {
-            on_optimal_path[r][c] = true;
-            bool found = false;
-            for (int j = 0; j < queue_size; j++) {
-                if (queue[j].row == r && queue[j].col == c && queue[j].dir == (Direction)from_dir_ccw) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                queue[queue_size].row = r;
-                queue[queue_size].col = c;
-                queue[queue_size].dir = from_dir_ccw;
-                queue_size++;
-            }
-        }
-    }
-    
-    // Count tiles on optimal paths
-    int count = 0;
-    for (int r = 0; r < data->rows; r++) {
-        for (int c = 0; c < data->cols; c++) {
-            if (on_optimal_path[r][c]) {
-                count++;
+        for (int i = 0; i < num_next; i++) {
+            uint32_t ns = next_states[i];
+            if (bwd[ns] == UNREACHED || bwd[state] != weights[i] + bwd[ns] || is_visited(&st, ns)) continue;
+            
+            if (!tile_visited(&st, ns / 4)) result.best_tiles++;
+            set_visited(&st, ns);
+            
+            if (top >= stack_capacity) {
+                stack_capacity *= 2;
+                stack = realloc(stack, stack_capacity * sizeof(uint32_t));
             }
+            stack[top++] = ns;
         }
     }
     
-    return count;
+    free(stack);
+    search_state_free(&st);
+    return result;
 }
 
 int main(int argc, char* argv[]) {
@@ -354,10 +325,11 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    MazeResult result = solve(data);
+    printf("Part 1: %ld\n", result.best_cost);
+    printf("Part 2: %ld\n", result.best_tiles);
     
-    // TODO: Free allocated memory
+    free(data->grid);
     free(data);
     
     return 0;
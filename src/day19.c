@@ -5,130 +5,258 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
-#define MAX_PATTERNS 500
-#define MAX_DESIGNS 500
-#define MAX_PATTERN_LEN 20
-#define MAX_DESIGN_LEN 100
+// Arrangement counts grow exponentially with design length, so they are
+// kept in 128 bits like the day 7 and day 9 totals. Past that they wrap
+// modulo 2^128 (designs of a few hundred stripes can get there);
+// reachability is tracked alongside so part 1 stays exact regardless
+typedef uint128_t Ways;
 
+// Towel patterns compiled into a trie over the colors that occur in them.
+// Node 0 is the root; since no edge leads back to it, a 0 in `next` means
+// "no child".
 typedef struct {
-    char patterns[MAX_PATTERNS][MAX_PATTERN_LEN];
+    int* next;              // node_count x alphabet child table
+    bool* terminal;         // a pattern ends at this node
+    int node_count;
+    int capacity;
+    int alphabet;
+    signed char symbol[256]; // character -> child index, -1 if unused
+} PatternTrie;
+
+typedef struct {
+    char* text;        // the whole input; patterns and designs point into it
+    char** patterns;
     int num_patterns;
-    char designs[MAX_DESIGNS][MAX_DESIGN_LEN];
+    char** designs;
+    int* design_lens;
     int num_designs;
+    int max_design_len;
+    PatternTrie trie;
 } InputData;
 
+int trie_add_node(PatternTrie* trie) {
+    if (trie->node_count >= trie->capacity) {
+        trie->capacity *= 2;
+        trie->next = realloc(trie->next, (size_t)trie->capacity * trie->alphabet * sizeof(int));
+        trie->terminal = realloc(trie->terminal, trie->capacity * sizeof(bool));
+    }
+    int node = trie->node_count++;
+    memset(&trie->next[(size_t)node * trie->alphabet], 0, trie->alphabet * sizeof(int));
+    trie->terminal[node] = false;
+    return node;
+}
+
+void build_trie(PatternTrie* trie, char** patterns, int num_patterns) {
+    // Only colors that appear in some pattern get a child slot
+    memset(trie->symbol, -1, sizeof(trie->symbol));
+    trie->alphabet = 0;
+    for (int i = 0; i < num_patterns; i++) {
+        for (const char* c = patterns[i]; *c; c++) {
+            if (trie->symbol[(unsigned char)*c] < 0) {
+                trie->symbol[(unsigned char)*c] = trie->alphabet++;
+            }
+        }
+    }
+    if (trie->alphabet == 0) trie->alphabet = 1;
+    
+    trie->node_count = 0;
+    trie->capacity = 64;
+    trie->next = malloc((size_t)trie->capacity * trie->alphabet * sizeof(int));
+    trie->terminal = malloc(trie->capacity * sizeof(bool));
+    trie_add_node(trie);
+    
+    for (int i = 0; i < num_patterns; i++) {
+        int node = 0;
+        for (const char* c = patterns[i]; *c; c++) {
+            int* slot = &trie->next[(size_t)node * trie->alphabet + trie->symbol[(unsigned char)*c]];
+            if (*slot == 0) {
+                int child = trie_add_node(trie);
+                // trie_add_node may have moved the table
+                slot = &trie->next[(size_t)node * trie->alphabet + trie->symbol[(unsigned char)*c]];
+                *slot = child;
+            }
+            node = *slot;
+        }
+        trie->terminal[node] = true;
+    }
+}
+
+void free_trie(PatternTrie* trie) {
+    free(trie->next);
+    free(trie->terminal);
+}
+
+// Follow one character from `node`; returns 0 when no pattern continues
+static inline int trie_step(const PatternTrie* trie, int node, char c) {
+    int sym = trie->symbol[(unsigned char)c];
+    if (sym < 0) return 0;
+    return trie->next[(size_t)node * trie->alphabet + sym];
+}
+
 InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* text = read_file(filename);
+    if (!text) {
         perror("Error opening file");
         return NULL;
     }
     
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
+        free(text);
         return NULL;
     }
     
+    data->text = text;
     data->num_patterns = 0;
     data->num_designs = 0;
+    data->max_design_len = 0;
+    int pattern_capacity = 64;
+    int design_capacity = 64;
+    data->patterns = malloc(pattern_capacity * sizeof(char*));
+    data->designs = malloc(design_capacity * sizeof(char*));
+    data->design_lens = malloc(design_capacity * sizeof(int));
     
-    char line[4096];
-    // Read patterns (first line)
-    if (fgets(line, sizeof(line), file)) {
-        char* token = strtok(line, ", \n");
-        while (token != NULL && data->num_patterns < MAX_PATTERNS) {
-            strcpy(data->patterns[data->num_patterns], token);
-            data->num_patterns++;
-            token = strtok(NULL, ", \n");
+    // Patterns: the first line, separated by commas and spaces. Everything
+    // is cut up in place, so no pattern or design has a length limit.
+    char* p = text;
+    char* line_end = p + strcspn(p, "\n");
+    char* rest = *line_end ? line_end + 1 : line_end;
+    *line_end = '\0';
+    
+    while (*p) {
+        p += strspn(p, ", \r");
+        if (!*p) break;
+        
+        char* end = p + strcspn(p, ", \r");
+        if (data->num_patterns >= pattern_capacity) {
+            pattern_capacity *= 2;
+            data->patterns = realloc(data->patterns, pattern_capacity * sizeof(char*));
         }
+        data->patterns[data->num_patterns++] = p;
+        
+        p = end;
+        if (*p) *p++ = '\0';
     }
     
-    // Skip empty line
-    fgets(line, sizeof(line), file);
-    
-    // Read designs
-    while (fgets(line, sizeof(line), file) && data->num_designs < MAX_DESIGNS) {
-        line[strcspn(line, "\n")] = '\0'; // Remove newline
-        if (strlen(line) > 0) {
-            strcpy(data->designs[data->num_designs], line);
+    // Designs: every non-empty line after that
+    p = rest;
+    while (*p) {
+        char* end = p + strcspn(p, "\n");
+        char* next = *end ? end + 1 : end;
+        *end = '\0';
+        
+        int len = strcspn(p, "\r");
+        p[len] = '\0';
+        if (len > 0) {
+            if (data->num_designs >= design_capacity) {
+                design_capacity *= 2;
+                data->designs = realloc(data->designs, design_capacity * sizeof(char*));
+                data->design_lens = realloc(data->design_lens, design_capacity * sizeof(int));
+            }
+            data->designs[data->num_designs] = p;
+            data->design_lens[data->num_designs] = len;
             data->num_designs++;
+            if (len > data->max_design_len) data->max_design_len = len;
         }
+        
+        p = next;
     }
     
-    fclose(file);
+    build_trie(&data->trie, data->patterns, data->num_patterns);
     return data;
 }
 
-// Check if a design can be made from available patterns using DP
-bool can_make_design(const char* design, InputData* data) {
-    int len = strlen(design);
-    bool dp[MAX_DESIGN_LEN + 1];
-    memset(dp, false, sizeof(dp));
-    dp[0] = true; // Empty string can always be made
-    
-    for (int i = 1; i <= len; i++) {
-        for (int j = 0; j < data->num_patterns; j++) {
-            int pattern_len = strlen(data->patterns[j]);
-            if (pattern_len <= i && dp[i - pattern_len]) {
-                // Check if pattern matches at this position
-                if (strncmp(&design[i - pattern_len], data->patterns[j], pattern_len) == 0) {
-                    dp[i] = true;
-                    break;
-                }
+// Count the ways to make a design from available patterns using DP.
+// From every reachable position the trie is walked forward along the
+// design, adding that position's count to the end of each pattern it
+// passes, so the work per position is bounded by the longest matching
+// pattern. `ways` and `reach` hold len + 1 entries each.
+Ways count_ways_to_make_design(const char* design, int len, const PatternTrie* trie,
+                               Ways* ways, bool* reach, bool* possible) {
+    memset(ways, 0, (len + 1) * sizeof(Ways));
+    memset(reach, false, (len + 1) * sizeof(bool));
+    ways[0] = 1; // One way to make empty string
+    reach[0] = true;
+    
+    for (int i = 0; i < len; i++) {
+        if (!reach[i]) continue;
+        
+        int node = 0;
+        for (int j = i; j < len; j++) {
+            node = trie_step(trie, node, design[j]);
+            if (node == 0) break;
+            if (trie->terminal[node]) {
+                ways[j + 1] += ways[i];
+                reach[j + 1] = true;
             }
         }
     }
     
-    return dp[len];
+    *possible = reach[len];
+    return ways[len];
 }
 
-long part1(InputData* data) {
-    int count = 0;
+typedef struct {
+    long possible;
+    Ways total_ways;
+} DesignTotals;
+
+// Work assignment for one design counting thread, with its own DP buffers
+typedef struct {
+    const InputData* data;
+    int first;  // thread index: designs first, first + stride, ...
+    int stride;
+    DesignTotals totals;
+} DesignWorker;
+
+void* design_worker(void* arg) {
+    DesignWorker* w = arg;
+    const InputData* data = w->data;
+    Ways* ways = malloc((data->max_design_len + 1) * sizeof(Ways));
+    bool* reach = malloc((data->max_design_len + 1) * sizeof(bool));
     
-    for (int i = 0; i < data->num_designs; i++) {
-        if (can_make_design(data->designs[i], data)) {
-            count++;
-        }
+    for (int i = w->first; i < data->num_designs; i += w->stride) {
+        bool possible;
+        w->totals.total_ways += count_ways_to_make_design(data->designs[i], data->design_lens[i],
+                                                          &data->trie, ways, reach, &possible);
+        if (possible) w->totals.possible++;
     }
     
-    return count;
+    free(ways);
+    free(reach);
+    return NULL;
 }
 
-// Count number of ways to make a design from available patterns
-long long count_ways_to_make_design(const char* design, InputData* data) {
-    int len = strlen(design);
-    long long dp[MAX_DESIGN_LEN + 1];
-    memset(dp, 0, sizeof(dp));
-    dp[0] = 1; // One way to make empty string
-    
-    for (int i = 1; i <= len; i++) {
-        for (int j = 0; j < data->num_patterns; j++) {
-            int pattern_len = strlen(data->patterns[j]);
-            if (pattern_len <= i) {
-                // Check if pattern matches at this position
-                if (strncmp(&design[i - pattern_len], data->patterns[j], pattern_len) == 0) {
-                    dp[i] += dp[i - pattern_len];
-                }
-            }
-        }
+// One DP per design answers both parts: part 1 counts the designs that can
+// be made at all, part 2 sums the number of ways
+DesignTotals solve(InputData* data) {
+    int num_threads = thread_count(data->num_designs);
+    
+    DesignWorker* workers = malloc(num_threads * sizeof(DesignWorker));
+    for (int t = 0; t < num_threads; t++) {
+        workers[t] = (DesignWorker){
+            .data = data,
+            .first = t,
+            .stride = num_threads,
+            .totals = {0, 0},
+        };
     }
     
-    return dp[len];
-}
-
-long part2(InputData* data) {
-    long long total_ways = 0;
+    run_threads(design_worker, workers, sizeof(DesignWorker), num_threads);
     
-    for (int i = 0; i < data->num_designs; i++) {
-        total_ways += count_ways_to_make_design(data->designs[i], data);
+    DesignTotals totals = {0, 0};
+    for (int t = 0; t < num_threads; t++) {
+        totals.possible += workers[t].totals.possible;
+        totals.total_ways += workers[t].totals.total_ways;
     }
+    free(workers);
     
-    return total_ways;
+    return totals;
 }
 
 int main(int argc, char* argv[]) {
@@ -142,10 +270,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    DesignTotals totals = solve(data);
+    printf("Part 1: %ld\n", totals.possible);
+    print_uint128("Part 2", totals.total_ways);
     
-    // TODO: Free allocated memory
+    free_trie(&data->trie);
+    free(data->patterns);
+    free(data->designs);
+    free(data->design_lens);
+    free(data->text);
     free(data);
     
     return 0;
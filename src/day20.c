@@ -6,196 +6,494 @@
 #include <string.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <errno.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_PATH 1
+#endif
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
-#define MAX_SIZE 150
-
 typedef struct {
     int x, y;
 } Position;
 
 typedef struct {
-    char grid[MAX_SIZE][MAX_SIZE];
+    char* grid; // rows * cols, row-major
     int rows, cols;
     Position start, end;
 } InputData;
 
 InputData* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* content = read_file(filename);
+    if (!content) {
         perror("Error opening file");
         return NULL;
     }
     
     InputData* data = malloc(sizeof(InputData));
     if (!data) {
-        fclose(file);
+        free(content);
         return NULL;
     }
     
+    // Size the grid from the first line and the line count
+    data->cols = strcspn(content, "\n");
     data->rows = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), file) && data->rows < MAX_SIZE) {
-        line[strcspn(line, "\n")] = '\0';
-        data->cols = strlen(line);
-        
-        for (int c = 0; c < data->cols; c++) {
-            data->grid[data->rows][c] = line[c];
-            if (line[c] == 'S') {
-                data->start.x = c;
-                data->start.y = data->rows;
-            } else if (line[c] == 'E') {
-                data->end.x = c;
-                data->end.y = data->rows;
+    for (char* p = content; *p; ) {
+        char* eol = strchr(p, '\n');
+        if (eol != p) data->rows++;
+        if (!eol) break;
+        p = eol + 1;
+    }
+    
+    data->grid = malloc((size_t)data->rows * data->cols);
+    
+    int row = 0;
+    for (char* p = content; *p && row < data->rows; ) {
+        int len = strcspn(p, "\n");
+        if (len > 0) {
+            char* dst = data->grid + (size_t)row * data->cols;
+            memset(dst, '#', data->cols);
+            memcpy(dst, p, len < data->cols ? len : data->cols);
+            
+            for (int c = 0; c < data->cols; c++) {
+                if (dst[c] == 'S') {
+                    data->start.x = c;
+                    data->start.y = row;
+                } else if (dst[c] == 'E') {
+                    data->end.x = c;
+                    data->end.y = row;
+                }
             }
+            row++;
         }
-        data->rows++;
+        p += len;
+        if (*p == '\n') p++;
     }
     
-    fclose(file);
+    free(content);
     return data;
 }
 
-// BFS to find distances from a starting position
-void find_distances(InputData* data, Position start, int dist[MAX_SIZE][MAX_SIZE]) {
-    // Initialize distances
-    for (int y = 0; y < data->rows; y++) {
-        for (int x = 0; x < data->cols; x++) {
-            dist[y][x] = INT_MAX;
-        }
+// The race track with distances from the start, stored in one flat array.
+// The grid is padded by `pad` wall cells on every side so that any cheat
+// offset up to that radius can be read without bounds checks.
+typedef struct {
+    int* dist;   // steps from start, -1 for walls and padding
+    int stride;  // padded row width
+    int pad;
+    int* cells;  // padded indices of track cells in race order
+    int length;
+} Track;
+
+Track* build_track(InputData* data, int pad) {
+    Track* track = malloc(sizeof(Track));
+    track->pad = pad;
+    track->stride = data->cols + 2 * pad;
+    size_t padded_cells = (size_t)(data->rows + 2 * pad) * track->stride;
+    track->dist = malloc(padded_cells * sizeof(int));
+    for (size_t i = 0; i < padded_cells; i++) {
+        track->dist[i] = -1;
     }
     
-    // Queue for BFS
-    Position queue[MAX_SIZE * MAX_SIZE];
-    int qhead = 0, qtail = 0;
+    // BFS from the start; on a single corridor the queue is the race order
+    track->cells = malloc((size_t)data->rows * data->cols * sizeof(int));
+    track->length = 0;
     
-    queue[qtail++] = start;
-    dist[start.y][start.x] = 0;
+    int first = (data->start.y + pad) * track->stride + data->start.x + pad;
+    track->dist[first] = 0;
+    track->cells[track->length++] = first;
     
-    int dx[] = {0, 1, 0, -1};
-    int dy[] = {-1, 0, 1, 0};
+    int steps[] = {-track->stride, 1, track->stride, -1};
     
-    while (qhead < qtail) {
-        Position curr = queue[qhead++];
+    for (int head = 0; head < track->length; head++) {
+        int curr = track->cells[head];
         
         for (int d = 0; d < 4; d++) {
-            int nx = curr.x + dx[d];
-            int ny = curr.y + dy[d];
+            int next = curr + steps[d];
+            int y = next / track->stride - pad;
+            int x = next % track->stride - pad;
             
-            if (nx < 0 || nx >= data->cols || ny < 0 || ny >= data->rows) continue;
-            if (data->grid[ny][nx] == '#') continue;
-            if (dist[ny][nx] != INT_MAX) continue;
+            if (x < 0 || x >= data->cols || y < 0 || y >= data->rows) continue;
+            if (data->grid[(size_t)y * data->cols + x] == '#') continue;
+            if (track->dist[next] != -1) continue;
             
-            dist[ny][nx] = dist[curr.y][curr.x] + 1;
-            queue[qtail].x = nx;
-            queue[qtail].y = ny;
-            qtail++;
+            track->dist[next] = track->dist[curr] + 1;
+            track->cells[track->length++] = next;
+        }
+    }
+    
+    return track;
+}
+
+void track_free(Track* track) {
+    free(track->dist);
+    free(track->cells);
+    free(track);
+}
+
+// Cheat destinations within Manhattan distance `radius` (origin excluded),
+// as flat index deltas on the padded grid
+typedef struct {
+    int delta;
+    int dist;
+} Offset;
+
+Offset* diamond_offsets(int radius, int stride, int* count) {
+    Offset* offsets = malloc((2 * radius + 1) * (2 * radius + 1) * sizeof(Offset));
+    *count = 0;
+    
+    for (int dy = -radius; dy <= radius; dy++) {
+        int span = radius - abs(dy);
+        for (int dx = -span; dx <= span; dx++) {
+            if (dx == 0 && dy == 0) continue;
+            offsets[*count].delta = dy * stride + dx;
+            offsets[*count].dist = abs(dx) + abs(dy);
+            (*count)++;
+        }
+    }
+    
+    return offsets;
+}
+
+// Savings histogram: hist[d * row + s] counts cheats of length d saving s
+// picoseconds, for d up to the table radius and s in 1..track length. A
+// start cell has at most one cheat per (d, s), so no count exceeds the
+// number of start cells and 32 bits are enough.
+typedef struct {
+    uint32_t* hist;
+    int row;
+} SavingsHistogram;
+
+// Add every cheat of at most `radius` picoseconds that saves time, starting
+// from track cells [begin, end). The track is a single corridor, so a cheat
+// from a to b saves dist[b] - dist[a] - cheat length.
+void add_cheats(const Track* track, int radius, SavingsHistogram* h, int begin, int end) {
+    int num_offsets;
+    Offset* offsets = diamond_offsets(radius, track->stride, &num_offsets);
+    
+    for (int i = begin; i < end; i++) {
+        int cell = track->cells[i];
+        int base = track->dist[cell];
+        
+        for (int k = 0; k < num_offsets; k++) {
+            int savings = track->dist[cell + offsets[k].delta] - base - offsets[k].dist;
+            if (savings > 0) {
+                h->hist[offsets[k].dist * h->row + savings]++;
+            }
         }
     }
+    
+    free(offsets);
 }
 
-long part1(InputData* data) {
-    // Find distances from start and end
-    int dist_from_start[MAX_SIZE][MAX_SIZE];
-    int dist_from_end[MAX_SIZE][MAX_SIZE];
+// Path-index form of the track: point i is the cell i steps from the start,
+// with coordinates in separate contiguous arrays for vector loads
+typedef struct {
+    int* xs;
+    int* ys;
+    int length;
+} Path;
+
+Path* build_path(Track* track) {
+    Path* path = malloc(sizeof(Path));
+    path->length = track->length;
+    path->xs = malloc(track->length * sizeof(int));
+    path->ys = malloc(track->length * sizeof(int));
     
-    find_distances(data, data->start, dist_from_start);
-    find_distances(data, data->end, dist_from_end);
+    for (int i = 0; i < track->length; i++) {
+        path->xs[i] = track->cells[i] % track->stride - track->pad;
+        path->ys[i] = track->cells[i] / track->stride - track->pad;
+    }
     
-    // Normal path length
-    int normal_path_length = dist_from_start[data->end.y][data->end.x];
+    return path;
+}
+
+void path_free(Path* path) {
+    free(path->xs);
+    free(path->ys);
+    free(path);
+}
+
+// Add cheats from point i to points j > i; a cheat saves j - i - distance.
+// Consecutive points are one step apart, so the distance to i changes by at
+// most 1 per index: after seeing distance d > radius at j, the next j worth
+// testing is j + d - radius.
+static void scan_path_scalar(const Path* path, int i, int j, int radius, SavingsHistogram* h) {
+    int xi = path->xs[i];
+    int yi = path->ys[i];
     
-    int count = 0;
-    int min_savings = (data->rows < 20) ? 1 : 100; // Test vs real based on grid size
+    while (j < path->length) {
+        int d = abs(path->xs[j] - xi) + abs(path->ys[j] - yi);
+        if (d > radius) {
+            j += d - radius;
+            continue;
+        }
+        if (j - i - d > 0) h->hist[d * h->row + j - i - d]++;
+        j++;
+    }
+}
+
+#ifdef HAVE_AVX2_PATH
+// AVX2 version: skips like the scalar scan while out of reach, and tests
+// eight points per step once a point is within the radius
+__attribute__((target("avx2")))
+static void add_cheats_path_avx2(const Path* path, int radius, SavingsHistogram* h, int begin, int end) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i radius_limit = _mm256_set1_epi32(radius + 1);
     
-    // Check all possible cheats (2 picosecond cheats)
-    for (int y1 = 0; y1 < data->rows; y1++) {
-        for (int x1 = 0; x1 < data->cols; x1++) {
-            if (data->grid[y1][x1] == '#') continue;
+    for (int i = begin; i < end; i++) {
+        const __m256i xi = _mm256_set1_epi32(path->xs[i]);
+        const __m256i yi = _mm256_set1_epi32(path->ys[i]);
+        // savings = j - i - d > 0  <=>  j - d > i
+        const __m256i limit = _mm256_set1_epi32(i);
+        int j = i + 2;
+        
+        while (j + 8 <= path->length) {
+            // Far from point i the scalar skip moves fastest
+            int d0 = abs(path->xs[j] - path->xs[i]) + abs(path->ys[j] - path->ys[i]);
+            if (d0 > radius) {
+                j += d0 - radius;
+                continue;
+            }
             
-            // Try all positions within Manhattan distance 2
-            for (int dy = -2; dy <= 2; dy++) {
-                for (int dx = -2; dx <= 2; dx++) {
-                    if (abs(dx) + abs(dy) > 2) continue;
-                    if (dx == 0 && dy == 0) continue;
-                    
-                    int x2 = x1 + dx;
-                    int y2 = y1 + dy;
-                    
-                    if (x2 < 0 || x2 >= data->cols || y2 < 0 || y2 >= data->rows) continue;
-                    if (data->grid[y2][x2] == '#') continue;
-                    
-                    // Calculate path with cheat
-                    int cheat_dist = abs(dx) + abs(dy);
-                    int path_with_cheat = dist_from_start[y1][x1] + cheat_dist + dist_from_end[y2][x2];
-                    
-                    int savings = normal_path_length - path_with_cheat;
-                    if (savings >= min_savings) {
-                        count++;
-                    }
+            // Within reach, test the next eight points at once
+            __m256i jv = _mm256_add_epi32(_mm256_set1_epi32(j), lane);
+            __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(path->xs + j)), xi));
+            __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(path->ys + j)), yi));
+            __m256i d = _mm256_add_epi32(dx, dy);
+            
+            __m256i in_range = _mm256_cmpgt_epi32(radius_limit, d);
+            __m256i saves = _mm256_cmpgt_epi32(_mm256_sub_epi32(jv, d), limit);
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(in_range, saves)));
+            
+            if (mask) {
+                int dist[8];
+                _mm256_storeu_si256((__m256i*)dist, d);
+                while (mask) {
+                    int k = __builtin_ctz(mask);
+                    h->hist[dist[k] * h->row + j + k - i - dist[k]]++;
+                    mask &= mask - 1;
                 }
             }
+            j += 8;
         }
+        
+        scan_path_scalar(path, i, j, radius, h);
     }
+}
+#endif
+
+// Add cheats starting at points [begin, end) using the path-index
+// formulation instead of 2D lookups
+void add_cheats_path(const Path* path, int radius, SavingsHistogram* h, int begin, int end) {
+#ifdef HAVE_AVX2_PATH
+    if (__builtin_cpu_supports("avx2")) {
+        add_cheats_path_avx2(path, radius, h, begin, end);
+        return;
+    }
+#endif
+    
+    for (int i = begin; i < end; i++) {
+        scan_path_scalar(path, i, i + 2, radius, h);
+    }
+}
+
+typedef enum {
+    CHEAT_DIAMOND, // offset table over the padded distance grid
+    CHEAT_PATH     // pairwise over the path-index coordinate arrays
+} CheatMode;
+
+// Answers "how many cheats of at most r picoseconds save at least t" for any
+// r up to max_radius in O(1): at_least[r * row + t] is the count, built once
+// from the savings histogram by a prefix sum over r and a suffix sum over t
+typedef struct {
+    long* at_least;
+    int row;
+    int max_radius;
+} CheatTable;
+
+// Work assignment for one cheat counting thread
+typedef struct {
+    const Track* track;
+    const Path* path; // set in path-index mode
+    int radius;
+    int begin, end;
+    SavingsHistogram h;
+} CheatWorker;
+
+void* cheat_worker(void* arg) {
+    CheatWorker* w = arg;
+    if (w->path) {
+        add_cheats_path(w->path, w->radius, &w->h, w->begin, w->end);
+    } else {
+        add_cheats(w->track, w->radius, &w->h, w->begin, w->end);
+    }
+    return NULL;
+}
+
+// Work assignment for one reduction thread: sums entries [begin, end) of
+// every worker histogram into the table
+typedef struct {
+    const CheatWorker* workers;
+    int num_workers;
+    long* dest;
+    size_t begin, end;
+} ReduceWorker;
+
+void* reduce_worker(void* arg) {
+    ReduceWorker* w = arg;
     
-    return count;
+    for (int t = 0; t < w->num_workers; t++) {
+        const uint32_t* src = w->workers[t].h.hist;
+        for (size_t k = w->begin; k < w->end; k++) {
+            w->dest[k] += src[k];
+        }
+    }
+    return NULL;
 }
 
-long part2(InputData* data) {
-    // Find distances from start and end
-    int dist_from_start[MAX_SIZE][MAX_SIZE];
-    int dist_from_end[MAX_SIZE][MAX_SIZE];
+// Cap on the per-thread histograms together; past it fewer threads are used
+#define HISTOGRAM_BUDGET ((size_t)1 << 30)
+
+CheatTable* build_cheat_table(InputData* data, int max_radius, CheatMode mode) {
+    Track* track = build_track(data, max_radius);
     
-    find_distances(data, data->start, dist_from_start);
-    find_distances(data, data->end, dist_from_end);
+    CheatTable* table = malloc(sizeof(CheatTable));
+    table->max_radius = max_radius;
+    table->row = track->length + 1; // savings are below the track length
+    table->at_least = calloc((size_t)(max_radius + 1) * table->row, sizeof(long));
     
-    // Normal path length
-    int normal_path_length = dist_from_start[data->end.y][data->end.x];
+    Path* path = mode == CHEAT_PATH ? build_path(track) : NULL;
     
-    int count = 0;
-    int min_savings = (data->rows < 20) ? 50 : 100; // Test vs real based on grid size
-    int max_cheat_time = 20; // Part 2: up to 20 picoseconds
+    // Each thread counts one contiguous segment of the track into its own
+    // histogram, with as many threads as the histogram budget allows
+    size_t hist_size = (size_t)(max_radius + 1) * table->row;
+    size_t budget_threads = HISTOGRAM_BUDGET / (hist_size * sizeof(uint32_t));
+    int max_tasks = track->length;
+    if ((size_t)max_tasks > budget_threads) max_tasks = budget_threads > 0 ? (int)budget_threads : 1;
+    int num_threads = thread_count(max_tasks);
     
-    // Check all possible cheats (up to 20 picosecond cheats)
-    for (int y1 = 0; y1 < data->rows; y1++) {
-        for (int x1 = 0; x1 < data->cols; x1++) {
-            if (data->grid[y1][x1] == '#') continue;
-            if (dist_from_start[y1][x1] == INT_MAX) continue;
-            
-            // Try all positions within Manhattan distance max_cheat_time
-            for (int y2 = 0; y2 < data->rows; y2++) {
-                for (int x2 = 0; x2 < data->cols; x2++) {
-                    if (data->grid[y2][x2] == '#') continue;
-                    if (dist_from_end[y2][x2] == INT_MAX) continue;
-                    
-                    int cheat_dist = abs(x2 - x1) + abs(y2 - y1);
-                    if (cheat_dist == 0 || cheat_dist > max_cheat_time) continue;
-                    
-                    // Calculate path with cheat
-                    int path_with_cheat = dist_from_start[y1][x1] + cheat_dist + dist_from_end[y2][x2];
-                    
-                    int savings = normal_path_length - path_with_cheat;
-                    if (savings >= min_savings) {
-                        // Only count if we're actually saving time compared to normal path
-                        int normal_dist_between = abs(dist_from_start[y2][x2] - dist_from_start[y1][x1]);
-                        if (normal_dist_between > cheat_dist) {
-                            count++;
-                        }
-                    }
-                }
+    CheatWorker* workers = malloc(num_threads * sizeof(CheatWorker));
+    for (int t = 0; t < num_threads; t++) {
+        workers[t] = (CheatWorker){
+            .track = track,
+            .path = path,
+            .radius = max_radius,
+            .begin = (int)((long)track->length * t / num_threads),
+            .end = (int)((long)track->length * (t + 1) / num_threads),
+            .h = {calloc(hist_size, sizeof(uint32_t)), table->row},
+        };
+    }
+    
+    run_threads(cheat_worker, workers, sizeof(CheatWorker), num_threads);
+    
+    // Merge the histograms in parallel too: each thread owns a disjoint
+    // slice of the entries and sums it across all workers, so the merge
+    // costs O(threads × hist_size / threads) per thread instead of a serial
+    // O(threads × hist_size)
+    ReduceWorker* reducers = malloc(num_threads * sizeof(ReduceWorker));
+    for (int t = 0; t < num_threads; t++) {
+        reducers[t] = (ReduceWorker){
+            .workers = workers,
+            .num_workers = num_threads,
+            .dest = table->at_least,
+            .begin = hist_size * t / num_threads,
+            .end = hist_size * (t + 1) / num_threads,
+        };
+    }
+    run_threads(reduce_worker, reducers, sizeof(ReduceWorker), num_threads);
+    free(reducers);
+    
+    for (int t = 0; t < num_threads; t++) {
+        free(workers[t].h.hist);
+    }
+    free(workers);
+    
+    if (path) path_free(path);
+    track_free(track);
+    
+    // Turn the histogram into counts in place
+    for (int r = 0; r <= max_radius; r++) {
+        long* curr = table->at_least + (size_t)r * table->row;
+        for (int t = table->row - 2; t >= 0; t--) {
+            curr[t] += curr[t + 1];
+        }
+        if (r > 0) {
+            long* prev = curr - table->row;
+            for (int t = 0; t < table->row; t++) {
+                curr[t] += prev[t];
             }
         }
     }
     
-    return count;
+    return table;
+}
+
+// Cheats of at most `radius` picoseconds saving at least min_savings.
+// Returns -1 if radius is beyond the table's max_radius, since those cheats
+// were never counted.
+long cheat_query(const CheatTable* table, int radius, int min_savings) {
+    if (radius > table->max_radius) return -1;
+    if (radius < 0 || min_savings >= table->row) return 0;
+    if (min_savings < 1) min_savings = 1; // a cheat has to save time
+    return table->at_least[(size_t)radius * table->row + min_savings];
+}
+
+void cheat_table_free(CheatTable* table) {
+    free(table->at_least);
+    free(table);
+}
+
+long part1(CheatTable* table, int min_savings) {
+    return cheat_query(table, 2, min_savings);
+}
+
+long part2(CheatTable* table, int min_savings) {
+    return cheat_query(table, 20, min_savings);
+}
+
+// Parse a plain non-negative decimal that fits in an int
+bool parse_count(const char* s, int* out) {
+    if (*s < '0' || *s > '9') return false;
+    char* end;
+    errno = 0;
+    long value = strtol(s, &end, 10);
+    if (*end || errno == ERANGE || value > INT_MAX) return false;
+    *out = (int)value;
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    const char* input_file = (argc > 1 && strcmp(argv[1], "test") == 0) 
-        ? "inputs/day20_test.txt" 
-        : "inputs/day20.txt";
+    const char* input_file = "inputs/day20.txt";
+    // The example's answers are quoted at lower thresholds than the real 100
+    int part1_savings = 100;
+    int part2_savings = 100;
+    CheatMode mode = CHEAT_DIAMOND;
+    int query[2];
+    int query_args = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "test") == 0) {
+            input_file = "inputs/day20_test.txt";
+            part1_savings = 1;
+            part2_savings = 50;
+        } else if (strcmp(argv[i], "path") == 0) {
+            mode = CHEAT_PATH;
+        } else if (query_args < 2 && parse_count(argv[i], &query[query_args])) {
+            query_args++;
+        } else {
+            fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [test] [path] [radius min_savings]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (query_args == 1) {
+        fprintf(stderr, "Usage: %s [test] [path] [radius min_savings]\n", argv[0]);
+        return 1;
+    }
     
     InputData* data = parse_input(input_file);
     if (!data) {
@@ -203,10 +501,19 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Part 1: %ld\n", part1(data));
-    printf("Part 2: %ld\n", part2(data));
+    // One table answers both parts and the optional extra query
+    int max_radius = 20;
+    if (query_args == 2 && query[0] > max_radius) max_radius = query[0];
+    CheatTable* table = build_cheat_table(data, max_radius, mode);
+    
+    printf("Part 1: %ld\n", part1(table, part1_savings));
+    printf("Part 2: %ld\n", part2(table, part2_savings));
+    if (query_args == 2) {
+        printf("Radius %d, saving at least %d: %ld\n", query[0], query[1], cheat_query(table, query[0], query[1]));
+    }
     
-    // TODO: Free allocated memory
+    cheat_table_free(table);
+    free(data->grid);
     free(data);
     
     return 0;
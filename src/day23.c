@@ -9,220 +9,635 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define AOC_IMPLEMENTATION
 #include "aoc.h"
 
-#define MAX_NODES 1000
-#define MAX_EDGES 5000
-#define MAX_NAME_LEN 3
-#define MAX_CLIQUE_SIZE 20
-
-typedef struct {
-    char name[MAX_NAME_LEN];
-    int id;
-} Node;
-
+// Graph in CSR form: the neighbors of v are adjacency[offsets[v]] up to
+// adjacency[offsets[v + 1]], sorted ascending with no duplicates
 typedef struct {
-    Node nodes[MAX_NODES];
+    char* text;     // the whole input; names point into it
+    char** names;   // node id -> name
     int num_nodes;
-    bool adj[MAX_NODES][MAX_NODES];  // Adjacency matrix
-    int node_count;
+    int* offsets;
+    int* adjacency;
 } Graph;
 
 typedef struct {
-    int nodes[MAX_CLIQUE_SIZE];
+    int* nodes;
     int size;
 } Clique;
 
-// Find or create a node
-int get_node_id(Graph* g, const char* name) {
-    for (int i = 0; i < g->num_nodes; i++) {
-        if (strcmp(g->nodes[i].name, name) == 0) {
-            return i;
-        }
+static inline int node_degree(const Graph* g, int v) {
+    return g->offsets[v + 1] - g->offsets[v];
+}
+
+static inline const int* node_neighbors(const Graph* g, int v) {
+    return g->adjacency + g->offsets[v];
+}
+
+// Name -> node id while parsing. The puzzle's two-letter names index a flat
+// 26x26 table directly; any other name goes through an open-addressing
+// hash table (FNV-1a), so longer names work as well.
+typedef struct {
+    int direct[26 * 26];
+    char** keys;
+    int* ids;
+    size_t capacity;
+    size_t size;
+} NodeIds;
+
+void node_ids_init(NodeIds* ids) {
+    for (int i = 0; i < 26 * 26; i++) ids->direct[i] = -1;
+    ids->capacity = 64;
+    ids->size = 0;
+    ids->keys = calloc(ids->capacity, sizeof(char*));
+    ids->ids = malloc(ids->capacity * sizeof(int));
+}
+
+void node_ids_free(NodeIds* ids) {
+    free(ids->keys);
+    free(ids->ids);
+}
+
+static inline size_t name_slot(const NodeIds* ids, const char* name) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char* c = name; *c; c++) {
+        h = (h ^ (unsigned char)*c) * 0x100000001b3ULL;
     }
+    return h & (ids->capacity - 1);
+}
+
+void node_ids_grow(NodeIds* ids) {
+    NodeIds bigger = *ids;
+    bigger.capacity = ids->capacity * 2;
+    bigger.keys = calloc(bigger.capacity, sizeof(char*));
+    bigger.ids = malloc(bigger.capacity * sizeof(int));
     
-    // Create new node
-    if (g->num_nodes < MAX_NODES) {
-        strcpy(g->nodes[g->num_nodes].name, name);
-        g->nodes[g->num_nodes].id = g->num_nodes;
-        return g->num_nodes++;
+    for (size_t i = 0; i < ids->capacity; i++) {
+        if (!ids->keys[i]) continue;
+        size_t j = name_slot(&bigger, ids->keys[i]);
+        while (bigger.keys[j]) j = (j + 1) & (bigger.capacity - 1);
+        bigger.keys[j] = ids->keys[i];
+        bigger.ids[j] = ids->ids[i];
     }
     
-    return -1;
+    node_ids_free(ids);
+    *ids = bigger;
 }
 
-// Add edge to graph
-void add_edge(Graph* g, const char* a, const char* b) {
-    int id_a = get_node_id(g, a);
-    int id_b = get_node_id(g, b);
+// Find or create a node; `name` must stay valid as long as the graph
+int get_node_id(Graph* g, NodeIds* ids, char* name, int* names_capacity) {
+    int* slot;
+    
+    if (name[0] >= 'a' && name[0] <= 'z' && name[1] >= 'a' && name[1] <= 'z' && !name[2]) {
+        slot = &ids->direct[(name[0] - 'a') * 26 + (name[1] - 'a')];
+    } else {
+        if (2 * (ids->size + 1) > ids->capacity) node_ids_grow(ids);
+        size_t i = name_slot(ids, name);
+        while (ids->keys[i] && strcmp(ids->keys[i], name) != 0) {
+            i = (i + 1) & (ids->capacity - 1);
+        }
+        if (!ids->keys[i]) {
+            ids->keys[i] = name;
+            ids->ids[i] = -1;
+            ids->size++;
+        }
+        slot = &ids->ids[i];
+    }
     
-    if (id_a >= 0 && id_b >= 0) {
-        g->adj[id_a][id_b] = true;
-        g->adj[id_b][id_a] = true;
+    if (*slot < 0) {
+        // Create new node
+        if (g->num_nodes >= *names_capacity) {
+            *names_capacity *= 2;
+            g->names = realloc(g->names, *names_capacity * sizeof(char*));
+        }
+        g->names[g->num_nodes] = name;
+        *slot = g->num_nodes++;
     }
+    
+    return *slot;
 }
 
-// Check if a set of nodes forms a clique
-bool is_clique(Graph* g, int* nodes, int size) {
-    for (int i = 0; i < size; i++) {
-        for (int j = i + 1; j < size; j++) {
-            if (!g->adj[nodes[i]][nodes[j]]) {
-                return false;
+int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Turn an edge list into sorted CSR adjacency, dropping self loops and
+// repeated edges
+void build_adjacency(Graph* g, const int* edge_a, const int* edge_b, int num_edges) {
+    int n = g->num_nodes;
+    g->offsets = calloc(n + 1, sizeof(int));
+    
+    for (int e = 0; e < num_edges; e++) {
+        if (edge_a[e] == edge_b[e]) continue;
+        g->offsets[edge_a[e] + 1]++;
+        g->offsets[edge_b[e] + 1]++;
+    }
+    for (int v = 0; v < n; v++) g->offsets[v + 1] += g->offsets[v];
+    
+    g->adjacency = malloc((g->offsets[n] + 1) * sizeof(int));
+    int* fill = malloc((n + 1) * sizeof(int));
+    memcpy(fill, g->offsets, n * sizeof(int));
+    for (int e = 0; e < num_edges; e++) {
+        if (edge_a[e] == edge_b[e]) continue;
+        g->adjacency[fill[edge_a[e]]++] = edge_b[e];
+        g->adjacency[fill[edge_b[e]]++] = edge_a[e];
+    }
+    free(fill);
+    
+    // Sort each list and squeeze out duplicates, compacting as we go
+    int out = 0;
+    for (int v = 0; v < n; v++) {
+        int begin = g->offsets[v], end = g->offsets[v + 1];
+        qsort(g->adjacency + begin, end - begin, sizeof(int), compare_ints);
+        
+        g->offsets[v] = out;
+        for (int i = begin; i < end; i++) {
+            if (i == begin || g->adjacency[i] != g->adjacency[i - 1]) {
+                g->adjacency[out++] = g->adjacency[i];
             }
         }
     }
-    return true;
+    g->offsets[n] = out;
 }
 
 // Compare function for sorting node names
-int compare_nodes(const void* a, const void* b) {
-    return strcmp(((Node*)a)->name, ((Node*)b)->name);
+int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
 }
 
-// Bron-Kerbosch algorithm for finding maximum clique
-void bron_kerbosch(Graph* g, int* R, int R_size, int* P, int P_size, 
-                   int* X, int X_size, Clique* max_clique) {
-    if (P_size == 0 && X_size == 0) {
-        // Found a maximal clique
-        if (R_size > max_clique->size) {
-            max_clique->size = R_size;
-            memcpy(max_clique->nodes, R, R_size * sizeof(int));
+// Edges oriented from the lower to the higher (degree, id) rank, in CSR
+// form. Every node then has O(sqrt(E)) out-neighbors, which is what makes
+// triangle enumeration O(E^1.5).
+typedef struct {
+    int* offsets;
+    int* targets;
+} Orientation;
+
+static inline bool ranks_before(const Graph* g, int u, int v) {
+    int du = node_degree(g, u), dv = node_degree(g, v);
+    return du < dv || (du == dv && u < v);
+}
+
+// Orient all edges, or with `keep` only those whose head is kept
+Orientation orient_edges(const Graph* g, const bool* keep) {
+    int n = g->num_nodes;
+    Orientation o;
+    o.offsets = malloc((n + 1) * sizeof(int));
+    o.targets = malloc((g->offsets[n] / 2 + 1) * sizeof(int));
+    
+    int out = 0;
+    for (int u = 0; u < n; u++) {
+        o.offsets[u] = out;
+        for (int j = 0; j < node_degree(g, u); j++) {
+            int v = node_neighbors(g, u)[j];
+            if (ranks_before(g, u, v) && (!keep || keep[v])) o.targets[out++] = v;
         }
-        return;
     }
+    o.offsets[n] = out;
+    return o;
+}
+
+void free_orientation(Orientation* o) {
+    free(o->offsets);
+    free(o->targets);
+}
+
+// Count triangles, each exactly once from its lowest-ranked node u: mark
+// u's out-neighbors, then for each out-neighbor v look for marked nodes
+// among v's out-neighbors.
+//
+// With `marked`, only triangles containing a marked node are counted, and
+// the filter is applied before the intersection: when neither u nor v is
+// marked, only v's marked out-neighbors are scanned.
+//
+// With `per_node`, every counted triangle is also added to each of its
+// three nodes.
+long count_triangles(const Graph* g, const bool* marked, long* per_node) {
+    int n = g->num_nodes;
+    Orientation all = orient_edges(g, NULL);
+    Orientation to_marked = marked ? orient_edges(g, marked) : all;
     
-    // Make a copy of P for iteration
-    int P_copy[MAX_NODES];
-    memcpy(P_copy, P, P_size * sizeof(int));
+    int* stamp = malloc((n + 1) * sizeof(int));
+    for (int v = 0; v < n; v++) stamp[v] = -1;
+    if (per_node) memset(per_node, 0, n * sizeof(long));
     
-    for (int i = 0; i < P_size; i++) {
-        int v = P_copy[i];
+    long count = 0;
+    for (int u = 0; u < n; u++) {
+        int u_begin = all.offsets[u], u_end = all.offsets[u + 1];
+        if (u_end - u_begin < 2) continue;
         
-        // R ∪ {v}
-        int new_R[MAX_CLIQUE_SIZE];
-        memcpy(new_R, R, R_size * sizeof(int));
-        new_R[R_size] = v;
+        for (int a = u_begin; a < u_end; a++) stamp[all.targets[a]] = u;
         
-        // P ∩ N(v)
-        int new_P[MAX_NODES];
-        int new_P_size = 0;
-        for (int j = 0; j < P_size; j++) {
-            if (g->adj[v][P[j]]) {
-                new_P[new_P_size++] = P[j];
+        for (int a = u_begin; a < u_end; a++) {
+            int v = all.targets[a];
+            const Orientation* o = !marked || marked[u] || marked[v] ? &all : &to_marked;
+            
+            for (int b = o->offsets[v]; b < o->offsets[v + 1]; b++) {
+                int w = o->targets[b];
+                if (stamp[w] != u) continue;
+                
+                count++;
+                if (per_node) {
+                    per_node[u]++;
+                    per_node[v]++;
+                    per_node[w]++;
+                }
             }
         }
+    }
+    
+    free(stamp);
+    if (marked) free_orientation(&to_marked);
+    free_orientation(&all);
+    return count;
+}
+
+// Degeneracy ordering (Batagelj-Zaversnik): repeatedly remove a vertex of
+// minimum remaining degree, using bucket lists so the whole ordering is
+// O(V + E). Every vertex then has at most `degeneracy` neighbors later in
+// the order.
+int degeneracy_order(const Graph* g, int* order, int* rank) {
+    int n = g->num_nodes;
+    int max_degree = 0;
+    for (int v = 0; v < n; v++) {
+        if (node_degree(g, v) > max_degree) max_degree = node_degree(g, v);
+    }
+    
+    int* deg = malloc(n * sizeof(int));
+    int* bin = calloc(max_degree + 1, sizeof(int));
+    for (int v = 0; v < n; v++) {
+        deg[v] = node_degree(g, v);
+        bin[deg[v]]++;
+    }
+    
+    // bin[d] = start of the vertices with remaining degree d in `order`
+    int start = 0;
+    for (int d = 0; d <= max_degree; d++) {
+        int count = bin[d];
+        bin[d] = start;
+        start += count;
+    }
+    for (int v = 0; v < n; v++) {
+        rank[v] = bin[deg[v]]++;
+        order[rank[v]] = v;
+    }
+    for (int d = max_degree; d > 0; d--) bin[d] = bin[d - 1];
+    bin[0] = 0;
+    
+    int degeneracy = 0;
+    for (int i = 0; i < n; i++) {
+        int v = order[i];
+        if (deg[v] > degeneracy) degeneracy = deg[v];
         
-        // X ∩ N(v)
-        int new_X[MAX_NODES];
-        int new_X_size = 0;
-        for (int j = 0; j < X_size; j++) {
-            if (g->adj[v][X[j]]) {
-                new_X[new_X_size++] = X[j];
+        for (int j = 0; j < node_degree(g, v); j++) {
+            int u = node_neighbors(g, v)[j];
+            if (deg[u] <= deg[v]) continue;
+            
+            // Move u to the front of its bucket, then shrink the bucket
+            int du = deg[u];
+            int pu = rank[u];
+            int pw = bin[du];
+            int w = order[pw];
+            if (u != w) {
+                order[pu] = w;
+                rank[w] = pu;
+                order[pw] = u;
+                rank[u] = pw;
             }
+            bin[du]++;
+            deg[u]--;
         }
+    }
+    
+    free(deg);
+    free(bin);
+    return degeneracy;
+}
+
+// Bron-Kerbosch state for one vertex's neighborhood. Vertices are renumbered
+// 0..k-1 with the initial P first (0..p-1), and all sets are bitsets of
+// `words` 64-bit words, so intersections are word-wise ANDs. Depth d of the
+// recursion owns three sets in `stack`: P, X and the candidates left to
+// branch on.
+//
+// P only ever holds ids below p, so a row for an X vertex is only ever
+// intersected with P and keeps just its first `p_words` words. The rows
+// then take O(p × k) bits rather than O(k²), which matters for the
+// neighbors of a high-degree hub.
+typedef struct {
+    int k;
+    int p;
+    int words;
+    int p_words;
+    uint64_t* rows;   // local adjacency: p full rows, then k-p short ones
+    size_t rows_capacity;
+    int* global;      // local id -> node id
+    uint64_t* stack;
+    int* R;           // current clique, as node ids
+    Clique* best;
+} CliqueSearch;
+
+static inline uint64_t* clique_row(const CliqueSearch* cs, int u) {
+    if (u < cs->p) return cs->rows + (size_t)u * cs->words;
+    return cs->rows + (size_t)cs->p * cs->words + (size_t)(u - cs->p) * cs->p_words;
+}
+
+static inline int bitset_count(const uint64_t* a, int words) {
+    int n = 0;
+    for (int w = 0; w < words; w++) n += __builtin_popcountll(a[w]);
+    return n;
+}
+
+static inline int bitset_and_count(const uint64_t* a, const uint64_t* b, int words) {
+    int n = 0;
+    for (int w = 0; w < words; w++) n += __builtin_popcountll(a[w] & b[w]);
+    return n;
+}
+
+// Bron-Kerbosch with Tomita pivoting: branch only on P \ N(u) for the u in
+// P ∪ X with the most neighbors in P. Since only the maximum clique is
+// wanted, branches that cannot beat it (|R| + |P| <= best) are cut.
+void bron_kerbosch(CliqueSearch* cs, int depth, int R_size) {
+    int words = cs->words;
+    int p_words = cs->p_words;
+    uint64_t* P = cs->stack + (size_t)depth * 3 * words;
+    uint64_t* X = P + words;
+    uint64_t* cand = X + words;
+    
+    int P_size = bitset_count(P, words);
+    if (P_size == 0) {
+        bool X_empty = true;
+        for (int w = 0; w < words && X_empty; w++) X_empty = X[w] == 0;
         
-        bron_kerbosch(g, new_R, R_size + 1, new_P, new_P_size, 
-                     new_X, new_X_size, max_clique);
+        if (X_empty && R_size > cs->best->size) {
+            // Found a larger maximal clique
+            cs->best->size = R_size;
+            memcpy(cs->best->nodes, cs->R, R_size * sizeof(int));
+        }
+        return;
+    }
+    if (R_size + P_size <= cs->best->size) return;
+    
+    // Pivot: the vertex of P ∪ X covering most of P
+    int pivot = -1, pivot_cover = -1;
+    for (int w = 0; w < words; w++) {
+        uint64_t bits = P[w] | X[w];
+        while (bits) {
+            int u = w * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            int cover = bitset_and_count(P, clique_row(cs, u), p_words);
+            if (cover > pivot_cover) {
+                pivot = u;
+                pivot_cover = cover;
+            }
+        }
+    }
+    
+    const uint64_t* pivot_row = clique_row(cs, pivot);
+    for (int w = 0; w < p_words; w++) cand[w] = P[w] & ~pivot_row[w];
+    
+    uint64_t* new_P = cand + words;
+    uint64_t* new_X = new_P + words;
+    
+    for (int w = 0; w < p_words; w++) {
+        while (cand[w]) {
+            int v = w * 64 + __builtin_ctzll(cand[w]);
+            uint64_t bit = cand[w] & -cand[w];
+            cand[w] &= cand[w] - 1;
+            
+            // P ∩ N(v), X ∩ N(v)
+            const uint64_t* row = clique_row(cs, v);
+            for (int i = 0; i < words; i++) {
+                new_P[i] = P[i] & row[i];
+                new_X[i] = X[i] & row[i];
+            }
+            
+            cs->R[R_size] = cs->global[v];
+            bron_kerbosch(cs, depth + 1, R_size + 1);
+            
+            // Move v from P to X
+            P[w] &= ~bit;
+            X[w] |= bit;
+            if (R_size + --P_size <= cs->best->size) return;
+        }
+    }
+}
+
+// Maximum clique by degeneracy ordering (Eppstein-Löffler-Strash): for each
+// vertex v, search the cliques containing v whose other members all come
+// later in the order. P is then at most the degeneracy, and the bitsets
+// only span v's neighbors, so large sparse graphs stay cheap.
+//
+// A node in a clique of size k lies in at least (k-1)(k-2)/2 triangles, so
+// with `triangles` (per-node counts from count_triangles) nodes that cannot
+// be in a larger clique than the best one are skipped before any search.
+Clique find_max_clique(const Graph* g, const long* triangles) {
+    int n = g->num_nodes;
+    int max_degree = 0;
+    for (int v = 0; v < n; v++) {
+        if (node_degree(g, v) > max_degree) max_degree = node_degree(g, v);
+    }
+    
+    int* order = malloc((n + 1) * sizeof(int));
+    int* rank = malloc((n + 1) * sizeof(int));
+    int degeneracy = degeneracy_order(g, order, rank);
+    
+    Clique best = {malloc((max_degree + 1) * sizeof(int)), 0};
+    int* local_of = malloc((n + 1) * sizeof(int));
+    for (int v = 0; v < n; v++) local_of[v] = -1;
+    
+    int max_words = (max_degree + 63) / 64 + 1;
+    CliqueSearch cs = {
+        .rows = NULL,
+        .rows_capacity = 0,
+        .global = malloc((max_degree + 1) * sizeof(int)),
+        .stack = malloc((size_t)(degeneracy + 3) * 3 * max_words * sizeof(uint64_t)),
+        .R = malloc((max_degree + 1) * sizeof(int)),
+        .best = &best,
+    };
+    
+    for (int i = 0; i < n; i++) {
+        int v = order[i];
+        
+        // Local ids: later neighbors (P) first, then earlier ones (X)
+        int k = 0;
+        for (int j = 0; j < node_degree(g, v); j++) {
+            int u = node_neighbors(g, v)[j];
+            if (rank[u] > i) cs.global[k++] = u;
+        }
+        int P_size = k;
+        if (1 + P_size <= best.size) continue;
+        if (triangles && triangles[v] < (long)best.size * (best.size - 1) / 2) continue;
+        
+        for (int j = 0; j < node_degree(g, v); j++) {
+            int u = node_neighbors(g, v)[j];
+            if (rank[u] < i) cs.global[k++] = u;
+        }
+        for (int j = 0; j < k; j++) local_of[cs.global[j]] = j;
+        
+        cs.k = k;
+        cs.p = P_size;
+        cs.words = (k + 63) / 64;
+        if (cs.words == 0) cs.words = 1;
+        cs.p_words = (P_size + 63) / 64;
+        if (cs.p_words == 0) cs.p_words = 1;
+        
+        size_t rows_size = (size_t)P_size * cs.words + (size_t)(k - P_size) * cs.p_words;
+        if (rows_size > cs.rows_capacity) {
+            cs.rows_capacity = rows_size > 2 * cs.rows_capacity ? rows_size : 2 * cs.rows_capacity;
+            free(cs.rows);
+            cs.rows = malloc(cs.rows_capacity * sizeof(uint64_t));
+        }
+        memset(cs.rows, 0, rows_size * sizeof(uint64_t));
         
-        // Remove v from P
-        for (int j = 0; j < P_size; j++) {
-            if (P[j] == v) {
-                for (int k = j; k < P_size - 1; k++) {
-                    P[k] = P[k + 1];
+        // Only edges with a P end are needed; each one fills both rows. A
+        // P vertex with more neighbors than the neighborhood (a hub) looks
+        // each local vertex up in its sorted list instead of scanning it.
+        for (int a = 0; a < P_size; a++) {
+            uint64_t* row = clique_row(&cs, a);
+            int u = cs.global[a];
+            int degree = node_degree(g, u);
+            const int* list = node_neighbors(g, u);
+            for (int j = 0; j < (degree > k ? k : degree); j++) {
+                int b;
+                if (degree > k) {
+                    b = j;
+                    if (!bsearch(&cs.global[b], list, degree, sizeof(int), compare_ints)) continue;
+                } else {
+                    b = local_of[list[j]];
+                    if (b < 0) continue;
                 }
-                P_size--;
-                break;
+                row[b >> 6] |= 1ULL << (b & 63);
+                if (b >= P_size) clique_row(&cs, b)[a >> 6] |= 1ULL << (a & 63);
             }
         }
         
-        // Add v to X
-        X[X_size++] = v;
+        uint64_t* P = cs.stack;
+        uint64_t* X = P + cs.words;
+        memset(P, 0, 2 * cs.words * sizeof(uint64_t));
+        for (int a = 0; a < k; a++) {
+            uint64_t* set = a < P_size ? P : X;
+            set[a >> 6] |= 1ULL << (a & 63);
+        }
+        
+        cs.R[0] = v;
+        bron_kerbosch(&cs, 0, 1);
+        
+        for (int j = 0; j < k; j++) local_of[cs.global[j]] = -1;
     }
+    
+    free(cs.rows);
+    free(cs.global);
+    free(cs.stack);
+    free(cs.R);
+    free(local_of);
+    free(order);
+    free(rank);
+    
+    return best;
 }
 
 Graph* parse_input(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    char* text = read_file(filename);
+    if (!text) {
         perror("Error opening file");
         return NULL;
     }
     
     Graph* g = calloc(1, sizeof(Graph));
     if (!g) {
-        fclose(file);
+        free(text);
         return NULL;
     }
     
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        char a[MAX_NAME_LEN], b[MAX_NAME_LEN];
-        if (sscanf(line, "%2s-%2s", a, b) == 2) {
-            add_edge(g, a, b);
+    g->text = text;
+    int names_capacity = 64;
+    g->names = malloc(names_capacity * sizeof(char*));
+    
+    NodeIds ids;
+    node_ids_init(&ids);
+    
+    int edge_capacity = 1024;
+    int num_edges = 0;
+    int* edge_a = malloc(edge_capacity * sizeof(int));
+    int* edge_b = malloc(edge_capacity * sizeof(int));
+    
+    // Lines are "a-b"; names are cut out of the text in place
+    char* line = text;
+    while (*line) {
+        char* end = line + strcspn(line, "\n");
+        char* next = *end ? end + 1 : end;
+        *end = '\0';
+        line[strcspn(line, "\r")] = '\0';
+        
+        char* dash = strchr(line, '-');
+        if (dash && dash != line && dash[1]) {
+            *dash = '\0';
+            
+            if (num_edges >= edge_capacity) {
+                edge_capacity *= 2;
+                edge_a = realloc(edge_a, edge_capacity * sizeof(int));
+                edge_b = realloc(edge_b, edge_capacity * sizeof(int));
+            }
+            edge_a[num_edges] = get_node_id(g, &ids, line, &names_capacity);
+            edge_b[num_edges] = get_node_id(g, &ids, dash + 1, &names_capacity);
+            num_edges++;
         }
+        
+        line = next;
     }
     
-    fclose(file);
+    build_adjacency(g, edge_a, edge_b, num_edges);
+    
+    free(edge_a);
+    free(edge_b);
+    node_ids_free(&ids);
     return g;
 }
 
 long part1(Graph* g) {
-    int count = 0;
-    
-    // Find all triangles
-    for (int i = 0; i < g->num_nodes; i++) {
-        for (int j = i + 1; j < g->num_nodes; j++) {
-            if (!g->adj[i][j]) continue;
-            
-            for (int k = j + 1; k < g->num_nodes; k++) {
-                if (g->adj[i][k] && g->adj[j][k]) {
-                    // Found a triangle
-                    // Check if any node starts with 't'
-                    if (g->nodes[i].name[0] == 't' || 
-                        g->nodes[j].name[0] == 't' || 
-                        g->nodes[k].name[0] == 't') {
-                        count++;
-                    }
-                }
-            }
-        }
+    // Triangles with at least one computer starting with 't'
+    bool* is_t = malloc((g->num_nodes + 1) * sizeof(bool));
+    for (int v = 0; v < g->num_nodes; v++) {
+        is_t[v] = g->names[v][0] == 't';
     }
     
+    long count = count_triangles(g, is_t, NULL);
+    
+    free(is_t);
     return count;
 }
 
 long part2(Graph* g) {
-    // Find maximum clique using Bron-Kerbosch
-    int R[MAX_CLIQUE_SIZE] = {0};
-    int P[MAX_NODES];
-    int X[MAX_NODES] = {0};
-    
-    // Initialize P with all vertices
-    for (int i = 0; i < g->num_nodes; i++) {
-        P[i] = i;
-    }
+    long* triangles = malloc((g->num_nodes + 1) * sizeof(long));
+    count_triangles(g, NULL, triangles);
     
-    Clique max_clique = {0};
-    bron_kerbosch(g, R, 0, P, g->num_nodes, X, 0, &max_clique);
+    Clique max_clique = find_max_clique(g, triangles);
+    free(triangles);
     
     // Sort nodes in the maximum clique by name
-    Node sorted_nodes[MAX_CLIQUE_SIZE];
+    char** sorted_names = malloc((max_clique.size + 1) * sizeof(char*));
     for (int i = 0; i < max_clique.size; i++) {
-        sorted_nodes[i] = g->nodes[max_clique.nodes[i]];
+        sorted_names[i] = g->names[max_clique.nodes[i]];
     }
-    qsort(sorted_nodes, max_clique.size, sizeof(Node), compare_nodes);
+    qsort(sorted_names, max_clique.size, sizeof(char*), compare_names);
     
     // Print the password (comma-separated sorted names)
     printf("Part 2: ");
     for (int i = 0; i < max_clique.size; i++) {
-        printf("%s", sorted_nodes[i].name);
+        printf("%s", sorted_names[i]);
         if (i < max_clique.size - 1) {
             printf(",");
         }
     }
     printf("\n");
     
+    free(sorted_names);
+    free(max_clique.nodes);
     return max_clique.size;
 }
 
@@ -240,6 +655,10 @@ int main(int argc, char* argv[]) {
     printf("Part 1: %ld\n", part1(g));
     part2(g);  // Part 2 prints directly
     
+    free(g->names);
+    free(g->offsets);
+    free(g->adjacency);
+    free(g->text);
     free(g);
     
     return 0;